@@ -0,0 +1,97 @@
+// MemoryPool с магазинами потоков против MemoryPool под мьютексом (магазины выключены) и malloc/free.
+// Все потоки работают с одним пулом, как писатели одного шарда: выделяют пачку ячеек по 64 байта
+// и освобождают её в другом порядке.
+// Запуск: ./kv_bench_allocator [макс_потоков]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kv/allocator.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr auto kDuration = std::chrono::milliseconds(500);
+constexpr size_t kBlockSize = 64;
+constexpr size_t kBatch = 64;
+
+struct PoolAlloc {
+    kv::MemoryPool& pool;
+    void* allocate() { return pool.allocate(); }
+    void deallocate(void* p) { pool.deallocate(p); }
+};
+
+struct MallocAlloc {
+    void* allocate() { return std::malloc(kBlockSize); }
+    void deallocate(void* p) { std::free(p); }
+};
+
+// Миллионы пар allocate + deallocate в секунду.
+template <typename Alloc>
+double run(Alloc alloc, size_t threads) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> total{0};
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            void* cells[kBatch];
+            size_t ops = 0;
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (size_t i = 0; i < kBatch; ++i) {
+                    cells[i] = alloc.allocate();
+                    *static_cast<char*>(cells[i]) = static_cast<char>(i);
+                }
+                // Через одну: ячейки возвращаются не в том порядке, в каком выданы.
+                for (size_t i = 0; i < kBatch; i += 2) {
+                    alloc.deallocate(cells[i]);
+                }
+                for (size_t i = 1; i < kBatch; i += 2) {
+                    alloc.deallocate(cells[i]);
+                }
+                ops += kBatch;
+            }
+            total.fetch_add(ops);
+        });
+    }
+
+    go.store(true, std::memory_order_release);
+    auto start = Clock::now();
+    std::this_thread::sleep_for(kDuration);
+    stop.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(total.load()) / seconds / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (argc >= 2) {
+        maxThreads = std::stoul(argv[1]);
+    }
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    std::printf("%-8s %16s %16s %16s\n", "threads", "magazines", "mutex", "malloc");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        kv::MemoryPool magazinePool(kBlockSize);
+        kv::MemoryPool mutexPool(kBlockSize, 0);
+        double magazines = run(PoolAlloc{magazinePool}, threads);
+        double mutex = run(PoolAlloc{mutexPool}, threads);
+        double heap = run(MallocAlloc{}, threads);
+        std::printf("%-8zu %10.2f Mops/s %10.2f Mops/s %10.2f Mops/s\n", threads, magazines, mutex, heap);
+    }
+    return 0;
+}
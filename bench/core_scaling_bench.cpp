@@ -0,0 +1,197 @@
+// Масштабирование режима ядро-на-поток: сервер с 1, 2, 4... ядрами (каждое — в отдельном
+// дочернем процессе, run() не возвращается) и клиенты, которые держат в соединении depth
+// команд смеси GET/SET (каждая пятая — SET) по случайным ключам, то есть в основном по шардам
+// чужих ядер. Печатает команды в секунду и ускорение относительно одного ядра. Клиенты работают
+// на той же машине, так что ядер процессора должно хватать и серверу, и им.
+// Запуск: ./kv_bench_core_scaling [макс_ядер] [клиентов] [глубина_конвейера]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kv/logger.hpp"
+#include "kv/server.hpp"
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr auto kDuration = std::chrono::milliseconds(2000);
+constexpr size_t kKeys = 100000;
+
+#ifndef _WIN32
+
+uint16_t free_port() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        std::perror("free_port");
+        std::exit(1);
+    }
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// Подключается, пока сервер в дочернем процессе поднимает слушающий сокет.
+int connect_to(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::perror("connect");
+    std::exit(1);
+}
+
+// Отправляет batch и читает lines строк ответа. false — соединение закрыто.
+bool round_trip(int fd, const std::string& batch, size_t lines, std::string& reply) {
+    if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size())) {
+        return false;
+    }
+    reply.clear();
+    size_t seen = 0;
+    char buffer[16384];
+    while (seen < lines) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return false;
+        }
+        seen += static_cast<size_t>(std::count(buffer, buffer + n, '\n'));
+        reply.append(buffer, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+std::string key_of(size_t i) { return "key:" + std::to_string(i); }
+
+double run(size_t cores, size_t clients, size_t depth) {
+    uint16_t port = free_port();
+    pid_t child = ::fork();
+    if (child < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+    if (child == 0) {
+        auto* server = new kv::Server<std::string, std::string>("127.0.0.1", port);
+        server->set_core_threads(cores);
+        server->run();
+        std::_Exit(0);
+    }
+
+    // Заполнение: все ключи есть, так что GET всегда возвращает значение.
+    {
+        int fd = connect_to(port);
+        std::string reply;
+        for (size_t i = 0; i < kKeys; i += 1000) {
+            std::string batch;
+            for (size_t k = i; k < i + 1000; ++k) {
+                batch += "SET " + key_of(k) + " value" + std::to_string(k) + "\n";
+            }
+            round_trip(fd, batch, 1000, reply);
+        }
+        ::close(fd);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> total{0};
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < clients; ++c) {
+        workers.emplace_back([&, c] {
+            int fd = connect_to(port);
+            std::mt19937_64 rng(c + 1);
+            std::string batch;
+            std::string reply;
+            size_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                batch.clear();
+                for (size_t i = 0; i < depth; ++i) {
+                    size_t k = rng() % kKeys;
+                    batch += (i % 5 == 4 ? "SET " + key_of(k) + " value" + std::to_string(ops + i) : "GET " + key_of(k));
+                    batch += '\n';
+                }
+                if (!round_trip(fd, batch, depth, reply)) {
+                    break;
+                }
+                ops += depth;
+            }
+            ::close(fd);
+            total.fetch_add(ops);
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(kDuration);
+    stop.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    return static_cast<double>(total.load()) / seconds;
+}
+
+#endif
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    std::printf("fork-based benchmark is POSIX-only\n");
+#else
+    size_t maxCores = std::max(1u, std::thread::hardware_concurrency() / 2);
+    size_t clients = 16;
+    size_t depth = 16;
+    if (argc >= 2) {
+        maxCores = std::stoul(argv[1]);
+    }
+    if (argc >= 3) {
+        clients = std::stoul(argv[2]);
+    }
+    if (argc >= 4) {
+        depth = std::stoul(argv[3]);
+    }
+
+    kv::log::LoggerConfig cfg;
+    cfg.level = kv::log::Level::WARN;
+    cfg.to_console = true;
+    kv::log::Logger::instance().init(cfg);
+
+    std::printf("GET/SET 4:1, %zu keys, clients %zu, pipeline depth %zu, %u hardware threads\n", kKeys, clients,
+                depth, std::thread::hardware_concurrency());
+    double single = 0;
+    for (size_t cores = 1; cores <= maxCores; cores *= 2) {
+        double ops = run(cores, clients, depth);
+        if (cores == 1) {
+            single = ops;
+        }
+        std::printf("  cores %3zu: %10.0f cmd/s, x%.2f\n", cores, ops, single > 0 ? ops / single : 0.0);
+        std::fflush(stdout);
+    }
+#endif
+    return 0;
+}
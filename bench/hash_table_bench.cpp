@@ -0,0 +1,82 @@
+// Сравнение HashTable (цепочки) и FlatHashTable (открытая адресация).
+// Запуск: ./kv_bench_hash_table [число_ключей]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "kv/flat_hash_table.hpp"
+#include "kv/hash_table.hpp"
+#include "kv/sharded_hash_map.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> make_keys(size_t n, const char* prefix) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys.push_back(std::string(prefix) + std::to_string(i * 2654435761ULL));
+    }
+    return keys;
+}
+
+template <typename Fn>
+double ns_per_op(size_t ops, Fn&& fn) {
+    auto start = Clock::now();
+    fn();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    return static_cast<double>(elapsed.count()) / static_cast<double>(ops);
+}
+
+template <typename Map>
+void run(const char* name, const std::vector<std::string>& keys,
+         const std::vector<std::string>& lookups, const std::vector<std::string>& misses) {
+    Map map;
+    const std::string value(64, 'v');
+    size_t found = 0;
+
+    double put = ns_per_op(keys.size(), [&] {
+        for (const auto& k : keys) map.put(k, value);
+    });
+    double hit = ns_per_op(lookups.size(), [&] {
+        for (const auto& k : lookups) found += map.get(k).has_value();
+    });
+    double miss = ns_per_op(misses.size(), [&] {
+        for (const auto& k : misses) found += map.get(k).has_value();
+    });
+    double erase = ns_per_op(keys.size(), [&] {
+        for (const auto& k : keys) found += map.erase(k);
+    });
+
+    std::printf("%-28s put %7.1f  get(hit) %7.1f  get(miss) %7.1f  erase %7.1f  ns/op  [%zu]\n",
+                name, put, hit, miss, erase, found);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t n = 1'000'000;
+    if (argc >= 2) {
+        n = std::stoul(argv[1]);
+    }
+
+    auto keys = make_keys(n, "key:");
+    auto misses = make_keys(n, "miss:");
+    auto lookups = keys;
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(42));
+
+    using Chained = kv::HashTable<std::string, std::string>;
+    using Flat = kv::FlatHashTable<std::string, std::string>;
+
+    std::printf("keys: %zu, value: 64 bytes\n", n);
+    run<Chained>("HashTable", keys, lookups, misses);
+    run<Flat>("FlatHashTable", keys, lookups, misses);
+    run<kv::ShardedHashMap<std::string, std::string>>("ShardedHashMap<HashTable>", keys, lookups, misses);
+    run<kv::ShardedHashMap<std::string, std::string, kv::StringHash, kv::StringEqual, Flat>>(
+        "ShardedHashMap<Flat>", keys, lookups, misses);
+    return 0;
+}
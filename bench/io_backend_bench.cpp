@@ -0,0 +1,201 @@
+// Цикл событий на epoll против io_uring: эхо-сервер на корутинах (async_accept, async_read,
+// async_write) в одном потоке и клиенты, которые держат в соединении depth запросов сразу.
+// Печатает запросы в секунду и системные вызовы цикла на запрос.
+// Запуск: ./kv_bench_io_backend [клиентов] [глубина_конвейера]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kv/coroutine_io.hpp"
+#include "kv/server.hpp"
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr auto kDuration = std::chrono::milliseconds(1000);
+constexpr size_t kRequestSize = 16;  // "PING" + пробелы + '\n'
+
+#ifndef _WIN32
+
+kv::Task echo(int fd) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = co_await kv::async_read(fd, buffer, sizeof(buffer));
+        if (n < 0 && kv::io_would_block()) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        size_t sent = 0;
+        while (sent < static_cast<size_t>(n)) {
+            ssize_t w = co_await kv::async_write(fd, buffer + sent, static_cast<size_t>(n) - sent);
+            if (w < 0 && !kv::io_would_block()) {
+                kv::EventLoop::instance().remove(fd);
+                co_return;
+            }
+            sent += w > 0 ? static_cast<size_t>(w) : 0;
+        }
+    }
+    kv::EventLoop::instance().remove(fd);
+}
+
+kv::Task accept_all(int listenFd) {
+    while (true) {
+        int fd = co_await kv::async_accept(listenFd);
+        if (fd >= 0) {
+            echo(fd);
+        }
+    }
+}
+
+int open_listener(uint16_t& port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 1024) < 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        std::perror("listener");
+        std::exit(1);
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int connect_to(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+struct Result {
+    kv::IoBackend backend;
+    double opsPerSecond;
+    double syscallsPerOp;
+};
+
+Result run(kv::IoBackend backend, size_t clients, size_t depth) {
+    kv::EventLoop::prefer_backend(backend);
+    uint16_t port = 0;
+    int listenFd = open_listener(port);
+
+    std::atomic<kv::EventLoop*> loop{nullptr};
+    std::atomic<kv::IoBackend> actual{backend};
+    std::uint64_t syscalls = 0;
+    std::thread server([&] {
+        kv::EventLoop& self = kv::EventLoop::instance();
+        actual.store(self.backend());
+        accept_all(listenFd);
+        loop.store(&self);
+        self.run();
+        syscalls = self.syscalls();
+    });
+    while (!loop.load()) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> total{0};
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < clients; ++c) {
+        workers.emplace_back([&] {
+            int fd = connect_to(port);
+            std::string batch;
+            for (size_t i = 0; i < depth; ++i) {
+                batch += "PING           \n";
+            }
+            std::vector<char> reply(batch.size());
+            size_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size())) {
+                    break;
+                }
+                size_t got = 0;
+                while (got < reply.size()) {
+                    ssize_t n = ::recv(fd, reply.data() + got, reply.size() - got, 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    got += static_cast<size_t>(n);
+                }
+                ops += got / kRequestSize;
+            }
+            ::close(fd);
+            total.fetch_add(ops);
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(kDuration);
+    stop.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    loop.load()->stop();
+    server.join();
+    ::close(listenFd);
+
+    double ops = static_cast<double>(total.load());
+    return Result{actual.load(), ops / seconds, ops > 0 ? static_cast<double>(syscalls) / ops : 0.0};
+}
+
+#endif
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    std::printf("io_uring is Linux-only\n");
+#else
+    size_t clients = 16;
+    size_t depth = 0;  // 0 — глубины 1 и 16
+    if (argc >= 2) {
+        clients = std::stoul(argv[1]);
+    }
+    if (argc >= 3) {
+        depth = std::stoul(argv[2]);
+    }
+    std::vector<size_t> depths = depth ? std::vector<size_t>{depth} : std::vector<size_t>{1, 16};
+
+    kv::log::LoggerConfig cfg;
+    cfg.level = kv::log::Level::WARN;
+    cfg.to_console = true;
+    kv::log::Logger::instance().init(cfg);
+
+    for (size_t d : depths) {
+        std::printf("clients %zu, pipeline depth %zu\n", clients, d);
+        for (kv::IoBackend backend : {kv::IoBackend::Epoll, kv::IoBackend::IoUring}) {
+            Result result = run(backend, clients, d);
+            if (result.backend != backend) {
+                std::printf("  io_uring: unavailable\n");
+                continue;
+            }
+            std::printf("  %-8s: %10.0f req/s, %5.2f loop syscalls/req\n",
+                        backend == kv::IoBackend::Epoll ? "epoll" : "io_uring", result.opsPerSecond,
+                        result.syscallsPerOp);
+        }
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Память и скорость поиска: HashNode<std::string, std::string> против PackedNode.
+// Ключи по 16 байт, значения по 64 байта.
+// Запуск: ./kv_bench_node_layout [число_ключей]
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+
+#include <fstream>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "kv/hash_table.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Память процесса: на Linux — резидентные страницы (узлы лежат и в malloc, и в аренах MemoryPool),
+// иначе байты, выданные malloc (0, если libc этого не сообщает).
+size_t heap_in_use() {
+#ifdef __linux__
+    size_t pages = 0;
+    size_t resident = 0;
+    std::ifstream("/proc/self/statm") >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#elif defined(__GLIBC__)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+std::string make_key(size_t i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "key:%012zu", i);
+    return std::string(buf, 16);
+}
+
+// Таблица живёт до конца main: иначе следующая заняла бы освобождённые ею страницы и замер занизился бы.
+template <typename Table>
+std::unique_ptr<Table> run(const char* name, const std::vector<std::string>& keys) {
+    const std::string value(64, 'v');
+
+    size_t before = heap_in_use();
+    auto table = std::make_unique<Table>();
+    for (const auto& k : keys) {
+        table->put(k, value);
+    }
+    size_t after = heap_in_use();
+
+    size_t found = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < 3; ++round) {
+        for (const auto& k : keys) {
+            found += static_cast<bool>(table->get_ref(k));
+        }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+    std::printf("%-34s %8.1f bytes/key   get_ref %6.1f ns/op  [%zu]\n", name,
+                static_cast<double>(after - before) / static_cast<double>(keys.size()),
+                static_cast<double>(ns) / static_cast<double>(keys.size() * 3), found);
+    return table;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t n = 1'000'000;
+    if (argc >= 2) {
+        n = std::stoul(argv[1]);
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys.push_back(make_key(i * 7919));
+    }
+
+    std::printf("keys: %zu, key: 16 bytes, value: 64 bytes\n", n);
+    auto hashNodes = run<kv::HashTable<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>>>(
+        "HashNode (pool + 2 heap strings)", keys);
+    auto packedNodes = run<kv::HashTable<std::string, std::string>>("PackedNode (single allocation)", keys);
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Масштабирование чтения по потокам: HashTable (get без блокировок)
+// против FlatHashTable (get под std::shared_mutex).
+// Запуск: ./kv_bench_read_scaling [макс_потоков] [число_ключей]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kv/flat_hash_table.hpp"
+#include "kv/sharded_hash_map.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr auto kDuration = std::chrono::milliseconds(500);
+
+template <typename Map>
+double run(Map& map, size_t threads, size_t keys) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> total{0};
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::string key;
+            size_t ops = 0;
+            size_t i = t * 7919;
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int batch = 0; batch < 256; ++batch) {
+                    key = "key:" + std::to_string(i++ % keys);
+                    ops += map.get(key).has_value();
+                }
+            }
+            total.fetch_add(ops);
+        });
+    }
+
+    go.store(true, std::memory_order_release);
+    auto start = Clock::now();
+    std::this_thread::sleep_for(kDuration);
+    stop.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(total.load()) / seconds / 1e6;
+}
+
+template <typename Map>
+void bench(const char* name, size_t maxThreads, size_t keys) {
+    Map map;
+    for (size_t i = 0; i < keys; ++i) {
+        map.put("key:" + std::to_string(i), std::string(32, 'v'));
+    }
+    std::printf("%s\n", name);
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        std::printf("  threads %2zu: %8.2f Mops/s\n", threads, run(map, threads, keys));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t maxThreads = std::thread::hardware_concurrency();
+    size_t keys = 100'000;
+    if (argc >= 2) {
+        maxThreads = std::stoul(argv[1]);
+    }
+    if (argc >= 3) {
+        keys = std::stoul(argv[2]);
+    }
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    using Flat = kv::FlatHashTable<std::string, std::string>;
+    bench<kv::ShardedHashMap<std::string, std::string>>("HashTable (epoch, no read lock)", maxThreads, keys);
+    bench<kv::ShardedHashMap<std::string, std::string, kv::StringHash, kv::StringEqual, Flat>>(
+        "FlatHashTable (shared_mutex)", maxThreads, keys);
+    return 0;
+}
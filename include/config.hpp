@@ -14,15 +14,133 @@ inline constexpr std::size_t THREAD_POOL_SIZE = 4;
 // Количество сегментов (shards) в sharded hash map.
 inline constexpr std::size_t HASH_MAP_SHARDS = 16;
 
+// До скольких шардов можно увеличить карту на ходу (RESHARD); массив шардов выделяется сразу.
+inline constexpr std::size_t MAX_HASH_MAP_SHARDS = 1024;
+
+// Разделение шарда: период фонового переноса (мс), сколько узлов переносится за одно взятие
+// блокировки шарда-источника и сколько времени на перенос может тратить один период (мкс).
+inline constexpr std::uint64_t RESHARD_TICK_MS = 10;
+inline constexpr std::size_t RESHARD_SLICE_KEYS = 256;
+inline constexpr std::uint64_t RESHARD_CYCLE_BUDGET_US = 2000;
+
+// Режим ядро-на-поток: число потоков со своим EventLoop, каждый владеет шардами s % CORE_THREADS == ядро.
+// 1 — шарды общие, под блокировками; соединения обслуживают IO_THREADS потоков.
+inline constexpr std::size_t CORE_THREADS = 1;
+
+// Режим без ядер (CORE_THREADS = 1): число потоков со своим EventLoop, между которыми по кругу
+// раздаются соединения; шарды общие, под блокировками.
+inline constexpr std::size_t IO_THREADS = 1;
+
+// Ёмкость очереди сообщений между парой ядер (запросы к чужим шардам и ответы на них).
+inline constexpr std::size_t CORE_QUEUE_CAPACITY = 4096;
+
+// Сколько корзин старого массива переносит одна операция во время инкрементального rehash.
+inline constexpr std::size_t REHASH_BUCKETS_PER_STEP = 8;
+
+// Сколько потоков одновременно могут читать хеш-таблицы без блокировок (слоты EpochDomain).
+inline constexpr std::size_t EPOCH_MAX_THREADS = 256;
+
+// Магазины MemoryPool: сколько свободных ячеек поток держит у себя (0 — без магазинов, каждая
+// операция пула под мьютексом) и сколько потоков одновременно получают магазины (остальные
+// работают с пулом под мьютексом).
+inline constexpr std::size_t POOL_MAGAZINE_SIZE = 32;
+inline constexpr std::size_t POOL_MAGAZINE_THREADS = 64;
+
+// Арены MemoryPool: память берётся у системы mmap-кусками по POOL_ARENA_BYTES (степень двойки),
+// для них запрашиваются huge pages (POOL_HUGE_PAGES), а пустые арены возвращаются системе
+// раз в POOL_TRIM_MS мс.
+inline constexpr std::size_t POOL_ARENA_BYTES = 2 * 1024 * 1024;
+inline constexpr bool POOL_HUGE_PAGES = true;
+inline constexpr std::uint64_t POOL_TRIM_MS = 1000;
+
+// SlabAllocator: наибольший класс размеров (крупнее — ::operator new) и сколько байт свободных
+// ячеек класса поток держит в магазине (не больше POOL_MAGAZINE_SIZE ячеек).
+inline constexpr std::size_t SLAB_MAX_SIZE = 16 * 1024;
+inline constexpr std::size_t SLAB_MAGAZINE_BYTES = 16 * 1024;
+
+// Активная дефрагментация: пул узлов дефрагментируется, когда свободных ячеек в его аренах не меньше
+// DEFRAG_THRESHOLD_PERCENT; из арен, занятых меньше чем на DEFRAG_ARENA_FILL_PERCENT, узлы переносятся
+// в плотные. Период (мс), порция узлов на одно взятие блокировки шарда и доля процессорного времени
+// (процент одного ядра; 0 — дефрагментация выключена).
+inline constexpr std::size_t DEFRAG_THRESHOLD_PERCENT = 10;
+inline constexpr std::size_t DEFRAG_ARENA_FILL_PERCENT = 50;
+inline constexpr std::uint64_t DEFRAG_TICK_MS = 100;
+inline constexpr std::size_t DEFRAG_SLICE_KEYS = 64;
+inline constexpr std::size_t DEFRAG_CPU_PERCENT = 5;
+
+// Сколько отложенно удалённых узлов копит шард, прежде чем пытаться их освободить.
+inline constexpr std::size_t EPOCH_RECLAIM_BATCH = 64;
+
+// Разрешение колеса таймеров TTL и период активного истечения ключей (мс).
+inline constexpr std::uint64_t EXPIRE_TICK_MS = 100;
+
+// Сколько ключей шард удаляет за одно взятие блокировки при активном истечении.
+inline constexpr std::size_t EXPIRE_SLICE_KEYS = 256;
+
+// Сколько времени один период EventLoop может тратить на активное истечение (мкс).
+inline constexpr std::uint64_t EXPIRE_CYCLE_BUDGET_US = 2000;
+
+// Бюджет памяти всего хранилища в байтах (0 — без ограничения); делится поровну между шардами.
+inline constexpr std::size_t MAX_MEMORY_BYTES = 0;
+
+// Политика вытеснения ключей при превышении бюджета памяти.
+enum class EvictionPolicy : std::uint8_t { LRU, LFU };
+inline constexpr EvictionPolicy EVICTION_POLICY = EvictionPolicy::LRU;
+
+// Сколько ключей из случайных корзин шарда сравнивает одна попытка вытеснения.
+inline constexpr std::size_t EVICTION_SAMPLES = 5;
+
+// LFU: чем больше, тем медленнее растёт логарифмический счётчик обращений.
+inline constexpr std::uint32_t LFU_LOG_FACTOR = 10;
+
+// LFU: счётчик ключа уменьшается на 1 за каждые LFU_DECAY_WRITES записей в шард без обращений к нему.
+inline constexpr std::uint32_t LFU_DECAY_WRITES = 1u << 14;
+
+// SCAN: сколько ключей просматривается за вызов по умолчанию и максимум для COUNT.
+inline constexpr std::size_t SCAN_DEFAULT_COUNT = 10;
+inline constexpr std::size_t SCAN_MAX_COUNT = 1000;
+
+// Максимум ключей в одной пакетной команде (MGET/MSET/MDEL).
+inline constexpr std::size_t MAX_BATCH_KEYS = 256;
+
 // Максимальная длина ключа (в байтах), если вы лимитируете строковые ключи.
 inline constexpr std::size_t MAX_KEY_SIZE = 128;
 
 // Максимальный размер значения (value) в байтах.
 inline constexpr std::size_t MAX_VALUE_SIZE = 1024 * 10;  // 10 KB
 
-// Лимит одновременных соединений (можно использовать для балансировки).
+// Буфер приёма соединения: начальный размер (и порция одного чтения) и предел длины одной команды.
+// Самая длинная допустимая команда — MSET из MAX_BATCH_KEYS пар предельной длины.
+inline constexpr std::size_t CONNECTION_BUFFER_SIZE = 4096;
+inline constexpr std::size_t MAX_REQUEST_SIZE = MAX_BATCH_KEYS * (MAX_KEY_SIZE + MAX_VALUE_SIZE + 2) + 64;
+
+// Буфер ответов соединения: значения не короче RESPONSE_REF_MIN_SIZE байт уходят в сокет прямо из
+// хранилища, без копирования; накопив RESPONSE_FLUSH_BYTES, ответы сбрасываются, не дожидаясь конца пачки.
+inline constexpr std::size_t RESPONSE_REF_MIN_SIZE = 512;
+inline constexpr std::size_t RESPONSE_FLUSH_BYTES = 64 * 1024;
+
+// Лимит одновременных соединений: сверх него новые соединения принимаются и сразу закрываются.
 inline constexpr std::size_t MAX_CONNECTIONS = 1024;
 
+// Длина очереди listen: сколько соединений ядро ОС держит до accept при всплеске подключений
+// (сверху ограничена net.core.somaxconn).
+inline constexpr std::size_t LISTEN_BACKLOG = 4096;
+
+// Linux: циклы событий на io_uring (операции ввода-вывода копятся и уходят в ядро одним вызовом
+// за проход цикла); false или ядро без io_uring — epoll. Переопределяется аргументом запуска.
+inline constexpr bool IO_URING = true;
+
+// Размер очереди отправки io_uring каждого цикла (степень двойки).
+inline constexpr unsigned URING_ENTRIES = 1024;
+
+// Буферы кольца для recv по CONNECTION_BUFFER_SIZE байт (степень двойки): общие на все соединения
+// цикла, занимаются только на время прихода данных.
+inline constexpr unsigned URING_BUFFERS = 1024;
+
+// Сжатие значений: значения не короче COMPRESS_MIN_VALUE_SIZE байт хранятся сжатыми (kv::lz),
+// если это их уменьшает; 0 — сжатие выключено.
+inline constexpr std::size_t COMPRESS_MIN_VALUE_SIZE = 1024;
+
 // Логический флаг: включать ли расширенную (debug) трассировку.
 inline constexpr bool ENABLE_DEBUG_LOG = true;
 
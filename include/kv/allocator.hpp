@@ -1,44 +1,227 @@
 // файл: include/kv/allocator.hpp
 #pragma once
+#include <atomic>
 #include <cstddef>
+#include <memory>
 #include <mutex>
 #include <new>
 #include <vector>
 
+#include "config.hpp"
+
 namespace kv {
 
 /*
     Простая реализация memory pool-а для объектов фиксированного размера.
-    Каждый раз, когда список свободных ячеек пуст, мы выделяем новый большой блок (через malloc)
-    и разрезаем его на chunks размером blockSize_ -> кладём в свободный список.
+    Память берётся у системы аренами: mmap-кусками по POOL_ARENA_BYTES, выровненными по своему
+    размеру, — арена ячейки находится маской адреса. Для арен запрашиваются huge pages
+    (MADV_HUGEPAGE, POOL_HUGE_PAGES): узлы таблиц разбросаны по памяти, и меньше промахов TLB
+    заметно ускоряет поиск. Ячейки нарезаются из арены по мере надобности, так что нетронутая
+    часть арены не занимает физическую память.
+
+    У каждой арены — свой список свободных ячеек и счётчик выданных (live). Когда после массового
+    удаления все ячейки арены вернулись, trim() (фоново, раз в POOL_TRIM_MS) отдаёт её системе:
+    одну пустую арену пул оставляет про запас, сбросив её страницы MADV_DONTNEED, остальные
+    освобождает munmap. Ячейки выдаются из самой первой арены со свободным местом, а опустевшие
+    арены уходят в конец списка — новые выделения не мешают им опустеть.
+
+    Магазины: у каждого потока (до POOL_MAGAZINE_THREADS) в пуле есть свой короткий список
+    свободных ячеек, с которым работает только он, — allocate/deallocate обычно не берут mtx_.
+    Пустой магазин пополняется из арен, а переполненный возвращает в них половину ячеек — оба
+    раза пачкой под одним взятием mtx_. Ячейки взаимозаменяемы, поэтому ячейку, выделенную одним
+    потоком, можно освободить в другом: она просто попадёт в его магазин. Завершающийся поток
+    возвращает ячейки своих магазинов во всех живых пулах их аренам и только потом освобождает
+    номер; освобождения из более поздних thread_local-деструкторов идут мимо магазина, под mtx_.
+    Ячейки в магазинах арена считает выданными.
+
+    Дефрагментация: если дыр в аренах пула набралось на целую арену и не меньше
+    DEFRAG_THRESHOLD_PERCENT, should_relocate(ячейка) отвечает, стоит ли перенести её содержимое.
+    Разреженная арена (занято меньше DEFRAG_ARENA_FILL_PERCENT и меньше, чем свободно) при этом
+    помечается осушаемой: новые ячейки из неё не выдаются, так что перенесённые через
+    allocate_dense узлы попадают в плотные арены, а она пустеет и уходит в trim(). Владелец
+    ячеек (HashTable::defrag_step) переносит их сам; end_defrag() по окончании прохода возвращает
+    в работу арены, которые так и не опустели (например, их ячейки держат выданные handle).
 */
 
+// Счётчики дефрагментации пула: перенесённые ячейки и память опустевших после этого арен.
+struct MagazineThreadExit;
+
+struct DefragStats {
+    size_t movedCells = 0;
+    size_t movedBytes = 0;
+    size_t reclaimedBytes = 0;
+
+    DefragStats& operator+=(const DefragStats& other) {
+        movedCells += other.movedCells;
+        movedBytes += other.movedBytes;
+        reclaimedBytes += other.reclaimedBytes;
+        return *this;
+    }
+};
+
 class MemoryPool {
    public:
-    MemoryPool(size_t blockSize, size_t blocksCount);
+    // magazineSize — ёмкость магазина потока; 0 — без магазинов, каждая операция под mtx_.
+    explicit MemoryPool(size_t blockSize, size_t magazineSize = kv::config::POOL_MAGAZINE_SIZE);
     ~MemoryPool();
 
     void* allocate();
     void deallocate(void* ptr);
 
+    size_t block_size() const { return blockSize_; }
+
+    // Возвращает системе пустые арены. Возвращает число освобождённых байт.
+    size_t trim();
+
+    // Дефрагментация (см. выше). fragmented и defrag_stats читают счётчики без блокировки.
+    bool fragmented() const;
+    bool should_relocate(const void* ptr);
+    void* allocate_dense();  // мимо магазина потока: в нём могут лежать ячейки осушаемых арен
+    void flush_magazine();   // магазин текущего потока — в арены
+    void end_defrag();
+    DefragStats defrag_stats() const;
+
+    // Память, полученная пулом у системы, и её незанятая часть (свободные и ещё не нарезанные
+    // ячейки арен, магазины потоков). Счётчики читаются без блокировки — для статистики.
+    size_t reserved_bytes() const { return reservedBytes_.load(std::memory_order_relaxed); }
+    size_t free_bytes() const;
+
     MemoryPool(const MemoryPool&) = delete;
     MemoryPool& operator=(const MemoryPool&) = delete;
 
    private:
+    friend struct MagazineThreadExit;
+
     struct FreeNode {
         FreeNode* next;
     };
 
+    // Заголовок в начале арены; все поля — под mtx_ (draining ещё читает deallocate без неё).
+    struct Arena {
+        Arena* prev;
+        Arena* next;
+        FreeNode* freeList;  // возвращённые ячейки
+        size_t freeCount;
+        size_t carved;  // нарезано ячеек; следующая берётся по адресу cells + carved * blockSize_
+        std::atomic<bool> draining;  // дефрагментация переносит из неё ячейки; новые не выдаются
+        bool drained;                // осушалась и ещё не опустела — опустев, пойдёт в reclaimedBytes_
+    };
+
+    // Магазин потока: head меняет только поток-владелец, count он же пишет для free_bytes.
+    struct alignas(64) Magazine {
+        FreeNode* head = nullptr;
+        std::atomic<size_t> count{0};
+    };
+
     size_t blockSize_;
-    size_t blocksCount_;
+    size_t magazineSize_;
+    size_t cellsPerArena_;
+
+    // Двусвязный список арен.
+    struct ArenaList {
+        Arena* head = nullptr;
+        Arena* tail = nullptr;
+
+        void push_front(Arena* arena);
+        void push_back(Arena* arena);
+        void remove(Arena* arena);
+    };
+
+    // Арены со свободными или ещё не нарезанными ячейками (пустые — в конце), заполненные
+    // и осушаемые дефрагментацией.
+    ArenaList available_;
+    ArenaList full_;
+    ArenaList draining_;
 
-    FreeNode* freeList_;
+    std::atomic<size_t> reservedBytes_{0};
+    std::atomic<size_t> freeCount_{0};  // свободные и не нарезанные ячейки арен
+    std::atomic<size_t> holeCount_{0};  // свободные ячейки арен, уже бывшие в деле
+    std::atomic<size_t> drainingCount_{0};  // осушаемые арены; пока их нет, deallocate не смотрит в арену
+    std::atomic<size_t> movedCells_{0};
+    std::atomic<size_t> reclaimedBytes_{0};
 
-    std::vector<void*> allBlocks_;
+    // Магазины по номеру потока; выделяются при первом обращении, чтобы неиспользуемый пул их не держал.
+    std::atomic<Magazine*> magazines_{nullptr};
 
     std::mutex mtx_;
 
-    void allocateBlock();
+    // Под mtx_.
+    void* take_cell();
+    void put_cell(FreeNode* node);
+    Arena* map_arena();
+    bool arena_full(const Arena* arena) const { return !arena->freeList && arena->carved == cellsPerArena_; }
+    bool arena_empty(const Arena* arena) const { return arena->freeCount == arena->carved; }
+    bool arena_sparse(const Arena* arena) const;
+    void drain_arena(Arena* arena);
+    static Arena* arena_of(const void* ptr);
+
+    Magazine* magazine();
+    void refill(Magazine& mag);
+    void flush(Magazine& mag, size_t n);
+    void flush_magazine(size_t slot);  // весь магазин потока slot — в арены
+};
+
+/*
+    Slab-аллокатор для выделений переменной длины (PackedNode: заголовок, ключ и значение одним
+    куском). Размер округляется вверх до класса: до 128 байт — с шагом 16, дальше по четыре класса
+    на каждое удвоение (160, 192, 224, 256, 320, ...) до SLAB_MAX_SIZE, так что выше 128 байт
+    округление съедает меньше пятой части выделения. Каждый класс — свой MemoryPool с магазинами потоков;
+    выделения крупнее SLAB_MAX_SIZE идут в ::operator new.
+
+    Один аллокатор на процесс: узел освобождается последним handle в любом потоке, а размер
+    класса восстанавливается из размера выделения, который передаёт deallocate.
+*/
+class SlabAllocator {
+   public:
+    static SlabAllocator& instance();
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr, size_t size);
+
+    // Сколько байт на самом деле занимает выделение size: размер класса или size для крупных.
+    static size_t allocation_size(size_t size);
+
+    // Занятость класса (для крупных выделений cellSize = 0, cells — их число).
+    struct ClassStats {
+        size_t cellSize;
+        size_t cells;           // выданные ячейки
+        size_t requestedBytes;  // сколько из них запрошено; остальное — округление до класса
+        size_t reservedBytes;   // взято у системы
+        size_t freeBytes;       // свободные ячейки (общий список и магазины)
+    };
+
+    // Классы, у которых есть память, и последним — крупные выделения. Без блокировок.
+    std::vector<ClassStats> stats() const;
+
+    // Возвращает системе пустые арены всех классов (MemoryPool::trim).
+    size_t trim();
+
+    // Дефрагментация по классам (MemoryPool::should_relocate и т.д.); крупные выделения не переносятся.
+    // allocate_dense — только для size <= SLAB_MAX_SIZE.
+    bool fragmented() const;
+    bool should_relocate(const void* ptr, size_t size);
+    void* allocate_dense(size_t size);
+    void flush_magazines();  // магазины текущего потока во всех классах — в арены
+    void end_defrag();
+    DefragStats defrag_stats() const;
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+   private:
+    SlabAllocator();
+
+    static size_t class_index(size_t size);
+    static size_t class_size(size_t index);
+
+    struct alignas(64) SizeClass {
+        std::unique_ptr<MemoryPool> pool;
+        std::atomic<size_t> requestedBytes{0};
+    };
+
+    std::unique_ptr<SizeClass[]> classes_;
+    std::atomic<size_t> largeCount_{0};
+    std::atomic<size_t> largeBytes_{0};
 };
 
 }  // namespace kv
@@ -0,0 +1,124 @@
+// файл: include/kv/core_mesh.hpp
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "kv/coroutine_io.hpp"
+#include "kv/spsc_queue.hpp"
+
+namespace kv {
+
+/*
+    Связь между ядрами в режиме ядро-на-поток (shared-nothing).
+
+    У каждого ядра свой поток и свой EventLoop; шарды данных принадлежат ядрам, и с шардом
+    работает только его ядро. Запрос к чужому шарду уходит сообщением владельцу, а ответ
+    возвращается сообщением обратно — блокировок на пути данных нет.
+
+    Для каждой упорядоченной пары ядер (from, to) есть своя SpscQueue, поэтому у каждой
+    очереди ровно один писатель и один читатель. Сообщения шлют только потоки ядер: соединения
+    принимает и обслуживает каждое ядро само. Получатель будится через EventLoop::wakeup(), но
+    не чаще, чем он успевает разобрать входящие: флаг pending гасит повторные пробуждения.
+*/
+class CoreMesh {
+   public:
+    // Сообщение: fn(ctx, arg) выполняется в потоке ядра-получателя.
+    struct Message {
+        void (*fn)(void* ctx, std::uintptr_t arg);
+        void* ctx;
+        std::uintptr_t arg;
+    };
+
+    static constexpr size_t kNoCore = static_cast<size_t>(-1);
+
+    explicit CoreMesh(size_t cores);
+
+    CoreMesh(const CoreMesh&) = delete;
+    CoreMesh& operator=(const CoreMesh&) = delete;
+
+    size_t cores() const { return cores_; }
+
+    // Привязывает вызывающий поток к ядру core и подписывает его EventLoop на входящие сообщения.
+    // Вызывать в потоке ядра до EventLoop::run().
+    void attach(size_t core);
+
+    // Ядро вызывающего потока; kNoCore — поток не привязан к ядру.
+    static size_t current();
+
+    // Отправляет сообщение ядру to. Вызывать из потока ядра (после attach).
+    void post(size_t to, Message msg);
+
+    // Выполняет сообщения, пришедшие ядру core (из его потока).
+    void drain(size_t core);
+
+   private:
+    struct alignas(64) Inbox {
+        std::atomic<bool> pending{false};
+        EventLoop* loop = nullptr;
+    };
+
+    SpscQueue<Message>& queue(size_t from, size_t to) { return *queues_[from * cores_ + to]; }
+
+    size_t cores_;
+    std::vector<std::unique_ptr<SpscQueue<Message>>> queues_;  // cores_ x cores_, строка — отправитель
+    std::unique_ptr<Inbox[]> inboxes_;
+};
+
+// Ожидание результата fn(), выполненного на ядре core. Если это текущее ядро (или mesh == nullptr —
+// режим с одним циклом событий), fn выполняется сразу, без приостановки корутины.
+// fn захватывает аргументы по ссылке: кадр корутины жив, пока она ждёт ответа.
+template <typename Fn>
+class RunOnCore {
+   public:
+    using Result = std::invoke_result_t<Fn&>;
+
+    RunOnCore(CoreMesh* mesh, size_t core, Fn fn) : mesh_(mesh), core_(core), fn_(std::move(fn)) {}
+
+    bool await_ready() {
+        if (!mesh_ || core_ == CoreMesh::current()) {
+            result_.emplace(fn_());
+            return true;
+        }
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> caller) {
+        caller_ = caller;
+        home_ = CoreMesh::current();
+        mesh_->post(core_, {&RunOnCore::execute, this, 0});
+    }
+
+    Result await_resume() { return std::move(*result_); }
+
+   private:
+    // На ядре-владельце: выполнить и вернуть продолжение корутины на её ядро.
+    static void execute(void* ctx, std::uintptr_t) {
+        auto* self = static_cast<RunOnCore*>(ctx);
+        self->result_.emplace(self->fn_());
+        self->mesh_->post(self->home_, {&RunOnCore::resume, self->caller_.address(), 0});
+    }
+
+    static void resume(void* ctx, std::uintptr_t) { std::coroutine_handle<>::from_address(ctx).resume(); }
+
+    CoreMesh* mesh_;
+    size_t core_;
+    size_t home_ = 0;
+    Fn fn_;
+    std::optional<Result> result_;
+    std::coroutine_handle<> caller_;
+};
+
+template <typename Fn>
+RunOnCore<Fn> run_on_core(CoreMesh* mesh, size_t core, Fn fn) {
+    return RunOnCore<Fn>(mesh, core, std::move(fn));
+}
+
+}  // namespace kv
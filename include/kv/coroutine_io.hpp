@@ -1,6 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +25,7 @@ using SOCKET_TYPE = SOCKET;  // SOCKET — typedef WinSock2
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
 #include <unistd.h>
 using SOCKET_TYPE = int;  // POSIX-дескриптор
 
@@ -26,6 +33,35 @@ using SOCKET_TYPE = int;  // POSIX-дескриптор
 
 namespace kv {
 
+#ifdef _WIN32
+inline const SOCKET_TYPE kInvalidSocket = INVALID_SOCKET;
+#else
+inline constexpr SOCKET_TYPE kInvalidSocket = -1;
+#endif
+
+// Механизм ввода-вывода цикла: готовность дескрипторов (epoll; на Windows — select) или io_uring.
+enum class IoBackend : std::uint8_t { Epoll, IoUring };
+
+class IoUring;
+struct AcceptAwaitable;
+
+// Операция io_uring в полёте: user_data SQE указывает на неё, по завершении цикл вызывает complete.
+// Живёт в awaitable (кадре корутины) или в самом цикле, пока операция не завершится.
+struct IoOperation {
+    static constexpr std::uint8_t kDirect = 1;     // recv прямо в data, мимо кольца буферов
+    static constexpr std::uint8_t kPollFirst = 2;  // сначала дождаться готовности сокета
+    static constexpr std::uint8_t kMultishot = 4;  // accept: одна операция на все соединения
+
+    void (*complete)(IoOperation& op, int res, std::uint32_t flags) = nullptr;
+    std::coroutine_handle<> handle;
+    int fd = -1;
+    std::uint8_t opcode = 0;  // IORING_OP_*
+    std::uint8_t flags = 0;
+    void* data = nullptr;  // буфер recv/send или msghdr для sendmsg
+    size_t size = 0;
+    int result = 0;  // байты или -errno
+};
+
 class EventLoop {
    public:
     EventLoop();
@@ -33,14 +69,73 @@ class EventLoop {
 
     void run();
 
+    // Завершает run() после текущего прохода; потокобезопасен.
+    void stop();
+
+    // Бэкенд для циклов, которые создаются после вызова (EventLoop::instance() в новых потоках);
+    // io_uring — если ядро его поддерживает, иначе epoll. По умолчанию config::IO_URING.
+    static void prefer_backend(IoBackend backend);
+    IoBackend backend() const { return backend_; }
+
+    // Системные вызовы цикла и его операций ввода-вывода; читать из потока цикла или после run().
+    std::uint64_t syscalls() const;
+    void count_syscall() { ++syscalls_; }
+
+#ifndef _WIN32
+    // io_uring: операция уходит в ядро вместе с остальными на следующем проходе цикла, по
+    // завершении корутина op.handle возобновляется с op.result. false — очередь переполнена.
+    bool submit(IoOperation& op);
+
+    // io_uring: приём соединений с listenFd (multishot accept). take_accepted отдаёт уже
+    // принятое соединение, wait_accepted — ждёт следующего.
+    bool take_accepted(int listenFd, AcceptAwaitable& awaiter);
+    bool wait_accepted(int listenFd, AcceptAwaitable& awaiter, std::coroutine_handle<> h);
+
+    // epoll: готовность дескриптора, запомненная по событиям. Дескриптор, о котором цикл ещё
+    // ничего не знает, считается готовым — первая операция пробует системный вызов сразу.
+    bool is_readable(int fd) const { return static_cast<size_t>(fd) >= fds_.size() || fds_[fd].readable; }
+    bool is_writable(int fd) const { return static_cast<size_t>(fd) >= fds_.size() || fds_[fd].writable; }
+
+    // Операция упёрлась в EAGAIN или выбрала всё доступное: готовность вернёт следующее событие.
+    void reset_readable(int fd) { slot(fd).readable = false; }
+    void reset_writable(int fd) { slot(fd).writable = false; }
+#endif
+
+    // Корутина ждёт готовности fd (неблокирующего). На Linux дескриптор регистрируется в epoll один
+    // раз на оба направления; вызывать только из потока цикла.
     void add_reader(SOCKET_TYPE fd, std::coroutine_handle<> h);
     void add_writer(SOCKET_TYPE fd, std::coroutine_handle<> h);
 
+    // Закрывает дескриптор и забывает его состояние в цикле.
     void remove(SOCKET_TYPE fd);
 
+    // Периодическая задача, выполняемая в потоке цикла между обработкой событий.
+    // Регистрировать до run(): список таймеров не защищён блокировкой.
+    void add_timer(std::chrono::milliseconds interval, std::function<void()> fn);
+
+    // Пробуждение цикла из другого потока (сообщения между ядрами, CoreMesh): wakeup()
+    // потокобезопасен, onWake выполняется в потоке цикла. Регистрировать до run().
+    void set_wakeup_handler(std::function<void()> onWake);
+    void wakeup();
+
+    // Цикл событий текущего потока: у каждого потока-ядра свой.
     static EventLoop& instance();
 
    private:
+    struct Timer {
+        std::chrono::steady_clock::time_point due;
+        std::chrono::milliseconds interval;
+        std::function<void()> fn;
+    };
+    std::vector<Timer> timers_;
+    std::function<void()> onWake_;
+    std::atomic<bool> stopped_{false};
+    IoBackend backend_ = IoBackend::Epoll;
+    std::uint64_t syscalls_ = 0;
+
+    // Выполняет созревшие таймеры; возвращает мс до ближайшего (-1 — таймеров нет).
+    int run_due_timers();
+
 #ifdef _WIN32
     // Для Windows сделаем select-базированный loop
     std::mutex handlersMutex_;
@@ -50,28 +145,62 @@ class EventLoop {
     void wait_and_handle_select();
 
 #else
-    // Для Linux: epoll
-    int epollFd_;
-    std::mutex handlersMutex_;
+    // Для Linux: epoll или io_uring
+    int epollFd_ = -1;
+    int wakeFd_ = -1;  // eventfd для wakeup()
+
+    // epoll: состояние дескриптора по его номеру. Дескриптор добавляется в epoll один раз
+    // (EPOLLIN | EPOLLOUT | EPOLLET), события только обновляют готовность и будят ждущих.
+    struct FdState {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+        bool registered = false;
+        bool readable = true;
+        bool writable = true;
+    };
+    std::vector<FdState> fds_;
+
+    FdState& slot(int fd);
+    void watch(int fd);
 
-    struct Handler {
-        std::coroutine_handle<> handle;
-        uint32_t events;
+    // io_uring: кольцо, ожидание eventfd и приём соединений по слушающим сокетам.
+    struct Acceptor : IoOperation {
+        std::deque<int> ready;  // принятые, но ещё не отданные (fd или -errno)
+        AcceptAwaitable* waiter = nullptr;
+        bool armed = false;
+        bool multishot = true;
     };
-    std::unordered_map<int, Handler> handlers_;
+    std::unique_ptr<IoUring> uring_;
+    IoOperation wakeOp_;
+    std::unordered_map<int, std::unique_ptr<Acceptor>> acceptors_;
+
+    bool init_uring();
+    Acceptor& acceptor_for(int listenFd);
+    bool arm_accept(Acceptor& acceptor);
+    static void finish_io(IoOperation& op, int res, std::uint32_t flags);
+    static void finish_accept(IoOperation& op, int res, std::uint32_t flags);
+    static void finish_wake(IoOperation& op, int res, std::uint32_t flags);
 
+    void drain_wakeups();
     void wait_and_handle_epoll();
+    void wait_and_handle_uring();
 #endif
 };
 
+// Awaitable'ы ввода-вывода: с epoll операция выполняется сразу в await_ready, если цикл помнит
+// дескриптор готовым, иначе корутина ждёт события и системный вызов делает await_resume; с io_uring
+// операция целиком отдаётся ядру (op_), и await_resume только забирает результат. await_suspend
+// возвращает false, если операцию не удалось поставить.
 struct ReadAwaitable {
     SOCKET_TYPE fd_;
     char* buffer_;
     size_t size_;
     ssize_t bytesRead_;
+    IoOperation op_{};
+    bool done_ = false;  // epoll: прочитано ещё в await_ready
 
-    bool await_ready() const noexcept { return false; }
-    void await_suspend(std::coroutine_handle<> h);
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> h);
     ssize_t await_resume();
 };
 
@@ -79,14 +208,35 @@ inline ReadAwaitable async_read(SOCKET_TYPE fd, char* buffer, size_t size) {
     return ReadAwaitable{fd, buffer, size, 0};
 }
 
+// Следующее соединение слушающего сокета (неблокирующее, CLOEXEC) или kInvalidSocket с ошибкой
+// в errno (EAGAIN — ждать дальше). Готовые соединения забираются без приостановки: с epoll —
+// пробным accept4, с io_uring — из очереди multishot accept.
+struct AcceptAwaitable {
+    SOCKET_TYPE fd_;
+    SOCKET_TYPE socket_ = kInvalidSocket;
+    int error_ = 0;
+    bool suspended_ = false;
+    bool waitReady_ = false;  // epoll: не пробовать accept до готовности сокета (после EMFILE и т.п.)
+
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> h);
+    SOCKET_TYPE await_resume();
+};
+
+inline AcceptAwaitable async_accept(SOCKET_TYPE listenFd, bool waitReady = false) {
+    return AcceptAwaitable{listenFd, kInvalidSocket, 0, false, waitReady};
+}
+
 struct WriteAwaitable {
     SOCKET_TYPE fd_;
     const char* buffer_;
     size_t size_;
     ssize_t bytesWritten_;
+    IoOperation op_{};
+    bool done_ = false;  // epoll: записано ещё в await_ready
 
-    bool await_ready() const noexcept { return false; }
-    void await_suspend(std::coroutine_handle<> h);
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> h);
     ssize_t await_resume();
 };
 
@@ -94,4 +244,51 @@ inline WriteAwaitable async_write(SOCKET_TYPE fd, const char* buffer, size_t siz
     return WriteAwaitable{fd, buffer, size, 0};
 }
 
+// Фрагмент данных для векторной записи (writev / WSASend).
+struct IoSlice {
+    const char* data;
+    size_t size;
+};
+
+// Максимум фрагментов за одну векторную запись (IOV_MAX); остальные пишутся следующим вызовом.
+inline constexpr size_t MAX_IO_SLICES = 1024;
+
+struct WritevAwaitable {
+    SOCKET_TYPE fd_;
+    const IoSlice* slices_;
+    size_t count_;
+    ssize_t bytesWritten_;
+    IoOperation op_{};
+#ifndef _WIN32
+    msghdr msg_{};  // io_uring: sendmsg прямо по массиву slices_ (раскладка IoSlice совпадает с iovec)
+#endif
+    bool done_ = false;  // epoll: записано ещё в await_ready
+
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> h);
+    ssize_t await_resume();
+};
+
+// Пишет несколько буферов одним системным вызовом, без склейки в промежуточную строку.
+inline WritevAwaitable async_writev(SOCKET_TYPE fd, const IoSlice* slices, size_t count) {
+    return WritevAwaitable{fd, slices, count, 0};
+}
+
+// Последняя операция ввода-вывода потока не выполнена только потому, что сокет не готов
+// (EAGAIN / WSAEWOULDBLOCK): её нужно повторить, а не закрывать соединение.
+bool io_would_block();
+
+// Сдвигает массив фрагментов на written уже записанных байт (после частичной записи).
+inline void consume_slices(IoSlice*& slices, size_t& count, size_t written) {
+    while (count > 0 && written >= slices->size) {
+        written -= slices->size;
+        ++slices;
+        --count;
+    }
+    if (count > 0) {
+        slices->data += written;
+        slices->size -= written;
+    }
+}
+
 }  // namespace kv
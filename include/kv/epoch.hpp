@@ -0,0 +1,99 @@
+// файл: include/kv/epoch.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "config.hpp"
+
+namespace kv {
+
+/*
+    Epoch-based reclamation для читателей без блокировок.
+
+    Читатель входит в критическую секцию (EpochGuard), публикуя текущую глобальную эпоху
+    в собственном слоте (отдельная кэш-линия — общую память читатель не пишет).
+    Писатель, отцепив объект от структуры, кладёт его в RetireList вместе с эпохой удаления.
+    Объект освобождается, когда глобальная эпоха ушла на 2 вперёд: к этому моменту
+    все читатели, которые могли его видеть, гарантированно вышли из своих секций.
+*/
+class EpochDomain {
+   public:
+    static EpochDomain& instance();
+
+    // Вход/выход текущего потока (поддерживается вложенность).
+    void enter();
+    void exit();
+
+    std::uint64_t current() const { return global_.load(std::memory_order_acquire); }
+
+    // Продвигает глобальную эпоху, если все активные читатели уже в текущей эпохе.
+    bool try_advance();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+   private:
+    EpochDomain() = default;
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{0};  // 0 — поток вне критической секции
+        std::atomic<bool> used{false};
+    };
+
+    friend struct EpochThreadState;
+
+    size_t acquire_slot();
+    void release_slot(size_t idx);
+
+    std::array<Slot, kv::config::EPOCH_MAX_THREADS> slots_;
+    std::atomic<size_t> highWater_{0};
+    std::atomic<std::uint64_t> global_{1};
+};
+
+// RAII-секция читателя.
+class EpochGuard {
+   public:
+    EpochGuard() { EpochDomain::instance().enter(); }
+    ~EpochGuard() { EpochDomain::instance().exit(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Список отложенного освобождения. Не потокобезопасен: владелец
+// (например, HashTable) вызывает его только под своей блокировкой писателя.
+class RetireList {
+   public:
+    using Deleter = void (*)(void* ctx, void* ptr);
+
+    RetireList() = default;
+    ~RetireList() { drain(); }
+
+    RetireList(const RetireList&) = delete;
+    RetireList& operator=(const RetireList&) = delete;
+
+    void retire(void* ptr, Deleter deleter, void* ctx);
+
+    // Освобождает всё, что пережило два продвижения эпохи.
+    void reclaim();
+
+    // Освобождает всё немедленно (когда читателей заведомо нет, например в деструкторе).
+    void drain();
+
+    size_t pending() const { return items_.size(); }
+
+   private:
+    struct Item {
+        void* ptr;
+        Deleter deleter;
+        void* ctx;
+        std::uint64_t epoch;
+    };
+    std::vector<Item> items_;
+};
+
+}  // namespace kv
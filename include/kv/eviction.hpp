@@ -0,0 +1,85 @@
+// файл: include/kv/eviction.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "config.hpp"
+
+namespace kv {
+
+/*
+    Метка доступа узла для приближённого LRU/LFU (поле access узла, 32 бита):
+
+        [ часы шарда, 24 бита | логарифмический счётчик обращений, 8 бит ]
+
+    Часы логические — это счётчик записей шарда: для выбора жертвы важен только порядок
+    обращений, а читателю не нужно ходить за системным временем. Читатель перезаписывает
+    метку, только если она изменилась: для LRU — когда часы сдвинулись с прошлого обращения,
+    для LFU — ещё и когда вырос счётчик. Рост логарифмический, так что чтения горячего ключа
+    почти всегда ничего не пишут и не гоняют его кэш-линию между ядрами.
+*/
+namespace access_stamp {
+
+inline constexpr std::uint32_t kClockMask = 0xFFFFFF;
+
+// Начальное значение счётчика LFU: новый ключ не должен вытесняться первым же SET.
+inline constexpr std::uint8_t kLfuInit = 5;
+
+inline std::uint32_t make(std::uint32_t clock, std::uint8_t counter) {
+    return ((clock & kClockMask) << 8) | counter;
+}
+
+inline std::uint32_t age(std::uint32_t stamp, std::uint32_t clock) { return (clock - (stamp >> 8)) & kClockMask; }
+
+inline std::uint8_t counter(std::uint32_t stamp) { return static_cast<std::uint8_t>(stamp & 0xFF); }
+
+// Счётчик с учётом затухания за время без обращений.
+inline std::uint8_t decayed_counter(std::uint32_t stamp, std::uint32_t clock) {
+    std::uint32_t periods = age(stamp, clock) / kv::config::LFU_DECAY_WRITES;
+    std::uint8_t c = counter(stamp);
+    return periods >= c ? 0 : static_cast<std::uint8_t>(c - periods);
+}
+
+// Вероятностный инкремент (как в Redis): чем больше счётчик, тем реже он растёт,
+// так что 8 бит хватает на миллионы обращений.
+inline std::uint8_t lfu_increment(std::uint8_t c) {
+    if (c == 255) {
+        return c;
+    }
+    thread_local std::uint64_t state = 0x9E3779B97F4A7C15ULL ^ reinterpret_cast<std::uintptr_t>(&state);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double r = static_cast<double>(state >> 11) * (1.0 / 9007199254740992.0);
+    double base = c > kLfuInit ? c - kLfuInit : 0;
+    return r < 1.0 / (base * kv::config::LFU_LOG_FACTOR + 1) ? static_cast<std::uint8_t>(c + 1) : c;
+}
+
+inline void touch(std::atomic<std::uint32_t>& access, std::uint32_t clock, kv::config::EvictionPolicy policy) {
+    std::uint32_t stamp = access.load(std::memory_order_relaxed);
+    // LRU-метке нечего менять, пока стоят часы. Счётчик LFU растёт и между записями в шард —
+    // иначе в фазе одних чтений горячий ключ не отличить от прочитанного однажды.
+    if (policy == kv::config::EvictionPolicy::LRU && (stamp >> 8) == (clock & kClockMask)) {
+        return;
+    }
+    std::uint32_t next = policy == kv::config::EvictionPolicy::LFU
+                             ? make(clock, lfu_increment(decayed_counter(stamp, clock)))
+                             : make(clock, counter(stamp));
+    if (next != stamp) {
+        access.store(next, std::memory_order_relaxed);
+    }
+}
+
+// Чем больше, тем лучше кандидат на вытеснение.
+inline std::uint64_t victim_score(std::uint32_t stamp, std::uint32_t clock, kv::config::EvictionPolicy policy) {
+    std::uint64_t a = age(stamp, clock);
+    if (policy == kv::config::EvictionPolicy::LFU) {
+        return (static_cast<std::uint64_t>(255 - decayed_counter(stamp, clock)) << 24) | a;
+    }
+    return a;
+}
+
+}  // namespace access_stamp
+
+}  // namespace kv
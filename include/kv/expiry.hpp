@@ -0,0 +1,71 @@
+// файл: include/kv/expiry.hpp
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "config.hpp"
+#include "kv/hash_node.hpp"
+
+namespace kv {
+
+// Монотонное время в миллисекундах: сроки жизни ключей не зависят от перевода системных часов.
+inline std::uint64_t now_ms() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+/*
+    Иерархическое колесо таймеров для ключей с TTL (одно на шард).
+
+    kLevels уровней по kSlots слотов, тик — EXPIRE_TICK_MS. Уровень 0 покрывает ближайшие
+    64 тика, каждый следующий — в 64 раза больший интервал (4 уровня ≈ 19 суток при тике
+    100 мс; более далёкие сроки перекладываются заново, когда до них доходит очередь).
+    Когда время доходит до слота верхнего уровня, его узлы каскадом переезжают ниже,
+    поэтому слот уровня 0 к моменту обработки содержит только истёкшие ключи.
+
+    Слоты — интрузивные списки через ExpiryLink узла: вставка и удаление за O(1),
+    сверх хвоста TTL-узла колесо памяти не требует. Не потокобезопасно: владелец
+    (HashTable) вызывает его только под блокировкой писателя.
+*/
+class ExpiryWheel {
+   public:
+    using ExpireFn = void (*)(void* ctx, PackedNode* node);
+
+    ExpiryWheel() : ExpiryWheel(now_ms()) {}
+    explicit ExpiryWheel(std::uint64_t nowMs);
+
+    ExpiryWheel(const ExpiryWheel&) = delete;
+    ExpiryWheel& operator=(const ExpiryWheel&) = delete;
+
+    // Ставит узел с has_expiry() в слот по его deadline.
+    void insert(PackedNode* node);
+
+    // Снимает узел с колеса (ничего не делает, если узла в колесе нет).
+    void remove(PackedNode* node);
+
+    // Продвигает колесо до nowMs и отдаёт истёкшие узлы в onExpired (узел к этому моменту
+    // уже снят с колеса). Обрабатывает не более budget узлов за вызов, включая каскадные
+    // переносы; возвращает true, если работа осталась.
+    bool advance(std::uint64_t nowMs, size_t budget, ExpireFn onExpired, void* ctx);
+
+    size_t size() const { return size_; }
+
+   private:
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr unsigned kLevels = 4;
+
+    static void link(PackedNode*& head, PackedNode* node);
+    static void unlink(PackedNode* node);
+
+    void place(PackedNode* node);
+
+    PackedNode* slots_[kLevels][kSlots] = {};
+    std::uint64_t tick_;  // следующий необработанный тик
+    size_t size_ = 0;
+};
+
+}  // namespace kv
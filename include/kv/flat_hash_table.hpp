@@ -0,0 +1,291 @@
+// файл: include/kv/flat_hash_table.hpp
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+
+#include "kv/hash_utils.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KV_FLAT_TABLE_SSE2 1
+#endif
+
+namespace kv {
+
+namespace flat_detail {
+
+// Управляющий байт слота: старший бит = 1 для пустых/удалённых,
+// иначе в младших 7 битах лежит отпечаток (H2) хеша ключа.
+inline constexpr std::int8_t kEmpty = -128;   // 0b10000000
+inline constexpr std::int8_t kDeleted = -2;   // 0b11111110
+inline constexpr std::size_t kGroupWidth = 16;
+
+// Битовая маска совпадений внутри группы из 16 управляющих байт.
+struct GroupMask {
+    std::uint32_t bits;
+
+    explicit operator bool() const noexcept { return bits != 0; }
+    unsigned lowest() const noexcept { return static_cast<unsigned>(std::countr_zero(bits)); }
+    void clear_lowest() noexcept { bits &= bits - 1; }
+};
+
+// Группа из 16 управляющих байт: сравнение сразу всех отпечатков.
+// С SSE2 это три инструкции, без него — переносимый цикл.
+struct Group {
+    const std::int8_t* ctrl;
+
+#ifdef KV_FLAT_TABLE_SSE2
+    GroupMask match(std::int8_t h2) const noexcept {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        __m128i m = _mm_cmpeq_epi8(_mm_set1_epi8(h2), v);
+        return GroupMask{static_cast<std::uint32_t>(_mm_movemask_epi8(m))};
+    }
+    GroupMask match_empty_or_deleted() const noexcept {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return GroupMask{static_cast<std::uint32_t>(_mm_movemask_epi8(v))};
+    }
+#else
+    GroupMask match(std::int8_t h2) const noexcept {
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= static_cast<std::uint32_t>(ctrl[i] == h2) << i;
+        }
+        return GroupMask{bits};
+    }
+    GroupMask match_empty_or_deleted() const noexcept {
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= static_cast<std::uint32_t>(ctrl[i] < 0) << i;
+        }
+        return GroupMask{bits};
+    }
+#endif
+    GroupMask match_empty() const noexcept { return match(kEmpty); }
+};
+
+}  // namespace flat_detail
+
+// Хеш-таблица с открытой адресацией (в духе SwissTable):
+//   - ctrl_: по одному управляющему байту на слот, слоты разбиты на группы по 16;
+//   - slots_: пары key/value лежат подряд в одном массиве, без узлов и указателей;
+//   - пробирование идёт по группам (квадратично), внутри группы — одним SIMD-сравнением
+//     7-битных отпечатков, так что до сравнения ключей обычно трогается одна кэш-линия ctrl_.
+// API совпадает с HashTable (put/get/erase/size), поэтому её можно подставить в ShardedHashMap.
+template <typename Key, typename Value, typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key> >
+class FlatHashTable {
+   public:
+    FlatHashTable(size_t initial_capacity = 1024)
+        : hash_(),
+          keyEqual_() {
+        allocate(capacity_for(initial_capacity));
+    }
+
+    ~FlatHashTable() {
+        destroy_all();
+        release();
+    }
+
+    FlatHashTable(const FlatHashTable&) = delete;
+    FlatHashTable& operator=(const FlatHashTable&) = delete;
+
+    bool put(const Key& key, const Value& value) {
+        std::unique_lock lock(tableMutex_);
+        std::uint64_t h = hash_of(key);
+
+        size_t found = find_index(key, h);
+        if (found != npos) {
+            slots_[found].value = value;
+            return true;
+        }
+
+        if (size_ + deleted_ + 1 > growth_limit()) {
+            // Много "надгробий" — достаточно перестроить таблицу того же размера.
+            rehash(deleted_ > size_ / 2 ? capacity_ : capacity_ * 2);
+        }
+
+        size_t idx = find_insert_slot(h);
+        if (ctrl_[idx] == flat_detail::kDeleted) {
+            --deleted_;
+        }
+        new (&slots_[idx]) Slot{key, value};
+        ctrl_[idx] = h2(h);
+        ++size_;
+        return true;
+    }
+
+    std::optional<Value> get(const Key& key) const { return get_impl(key); }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    std::optional<Value> get(const K& key) const {
+        return get_impl(key);
+    }
+
+    bool erase(const Key& key) { return erase_impl(key); }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    bool erase(const K& key) {
+        return erase_impl(key);
+    }
+
+    size_t size() { return size_; }
+
+   private:
+    struct Slot {
+        Key key;
+        Value value;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::int8_t* ctrl_ = nullptr;
+    Slot* slots_ = nullptr;
+    size_t capacity_ = 0;  // кратна 16 и является степенью двойки
+    size_t size_ = 0;
+    size_t deleted_ = 0;
+
+    mutable std::shared_mutex tableMutex_;
+
+    Hash hash_;
+    KeyEqual keyEqual_;
+
+    template <typename K>
+    std::optional<Value> get_impl(const K& key) const {
+        std::shared_lock lock(tableMutex_);
+
+        size_t idx = find_index(key, hash_of(key));
+        if (idx == npos) {
+            return std::nullopt;
+        }
+        return slots_[idx].value;
+    }
+
+    template <typename K>
+    bool erase_impl(const K& key) {
+        std::unique_lock lock(tableMutex_);
+
+        size_t idx = find_index(key, hash_of(key));
+        if (idx == npos) {
+            return false;
+        }
+        slots_[idx].~Slot();
+        // Если в группе уже есть пустой слот, ни одна цепочка пробирования
+        // не проходила через неё дальше — слот можно сразу пометить пустым.
+        size_t groupStart = idx & ~(flat_detail::kGroupWidth - 1);
+        if (flat_detail::Group{ctrl_ + groupStart}.match_empty()) {
+            ctrl_[idx] = flat_detail::kEmpty;
+        } else {
+            ctrl_[idx] = flat_detail::kDeleted;
+            ++deleted_;
+        }
+        --size_;
+        return true;
+    }
+
+    static size_t capacity_for(size_t n) {
+        size_t cap = round_up_pow2(n);
+        return cap < flat_detail::kGroupWidth ? flat_detail::kGroupWidth : cap;
+    }
+
+    // Максимальная заполненность 7/8, с учётом удалённых слотов.
+    size_t growth_limit() const { return capacity_ - capacity_ / 8; }
+
+    template <typename K>
+    std::uint64_t hash_of(const K& key) const {
+        return mix_hash(static_cast<std::uint64_t>(hash_(key)));
+    }
+    static std::int8_t h2(std::uint64_t h) { return static_cast<std::int8_t>(h & 0x7F); }
+    static size_t h1(std::uint64_t h) { return static_cast<size_t>(h >> 7); }
+
+    size_t group_mask() const { return capacity_ / flat_detail::kGroupWidth - 1; }
+
+    template <typename K>
+    size_t find_index(const K& key, std::uint64_t h) const {
+        const std::int8_t fingerprint = h2(h);
+        size_t group = h1(h) & group_mask();
+        for (size_t step = 1;; ++step) {
+            size_t base = group * flat_detail::kGroupWidth;
+            flat_detail::Group g{ctrl_ + base};
+            for (auto m = g.match(fingerprint); m; m.clear_lowest()) {
+                size_t idx = base + m.lowest();
+                if (keyEqual_(slots_[idx].key, key)) {
+                    return idx;
+                }
+            }
+            if (g.match_empty()) {
+                return npos;
+            }
+            // Треугольные числа обходят все группы при их числе, равном степени двойки.
+            group = (group + step) & group_mask();
+        }
+    }
+
+    size_t find_insert_slot(std::uint64_t h) const {
+        size_t group = h1(h) & group_mask();
+        for (size_t step = 1;; ++step) {
+            size_t base = group * flat_detail::kGroupWidth;
+            auto m = flat_detail::Group{ctrl_ + base}.match_empty_or_deleted();
+            if (m) {
+                return base + m.lowest();
+            }
+            group = (group + step) & group_mask();
+        }
+    }
+
+    void allocate(size_t capacity) {
+        capacity_ = capacity;
+        ctrl_ = static_cast<std::int8_t*>(::operator new(capacity_));
+        std::memset(ctrl_, flat_detail::kEmpty, capacity_);
+        slots_ = static_cast<Slot*>(::operator new(sizeof(Slot) * capacity_, std::align_val_t(alignof(Slot))));
+        size_ = 0;
+        deleted_ = 0;
+    }
+
+    void release() {
+        ::operator delete(ctrl_);
+        ::operator delete(slots_, std::align_val_t(alignof(Slot)));
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+    }
+
+    void destroy_all() {
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) {
+                slots_[i].~Slot();
+            }
+        }
+    }
+
+    void rehash(size_t newCapacity) {
+        std::int8_t* oldCtrl = ctrl_;
+        Slot* oldSlots = slots_;
+        size_t oldCapacity = capacity_;
+
+        allocate(newCapacity);
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] < 0) {
+                continue;
+            }
+            std::uint64_t h = hash_of(oldSlots[i].key);
+            size_t idx = find_insert_slot(h);
+            new (&slots_[idx]) Slot{std::move(oldSlots[i])};
+            ctrl_[idx] = h2(h);
+            ++size_;
+            oldSlots[i].~Slot();
+        }
+
+        ::operator delete(oldCtrl);
+        ::operator delete(oldSlots, std::align_val_t(alignof(Slot)));
+    }
+};
+
+}  // namespace kv
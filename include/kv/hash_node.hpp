@@ -0,0 +1,354 @@
+// файл: include/kv/hash_node.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+#include "kv/hash_utils.hpp"
+#include "kv/lz.hpp"
+
+namespace kv {
+
+// Закреплённое неизменяемое значение: держит буфер живым после выхода из таблицы,
+// даже если ключ тем временем перезаписан или удалён. Копирование — только счётчик ссылок.
+template <typename Value>
+class ValueHandle {
+   public:
+    ValueHandle() = default;
+    explicit ValueHandle(std::shared_ptr<const Value> value) : value_(std::move(value)) {}
+
+    explicit operator bool() const noexcept { return static_cast<bool>(value_); }
+    const Value& value() const noexcept { return *value_; }
+
+    // HashNode значения не сжимает (см. PackedValueHandle).
+    bool compressed() const noexcept { return false; }
+    const Value& plain(std::string&) const noexcept { return *value_; }
+
+   private:
+    std::shared_ptr<const Value> value_;
+};
+
+// Узел неизменяем после публикации: SET создаёт новый узел с новым буфером значения
+// и подменяет указатель в цепочке, поэтому читатель без блокировки всегда видит
+// согласованную пару key/value, а выданные ValueHandle продолжают ссылаться на старый буфер.
+template <typename Key, typename Value>
+struct HashNode {
+    Key key;
+    std::shared_ptr<const Value> value;
+    std::atomic<HashNode*> next;
+    std::atomic<std::uint32_t> access{0};  // метка LRU/LFU (eviction.hpp)
+};
+
+/*
+    Упакованный узел для строковых ключей и значений: заголовок, байты ключа и байты
+    значения лежат в одном выделении переменного размера.
+
+        [ next | hash | refs | valueLen | keyLen | flags | access ][ ExpiryLink? ][ int64? ][ key bytes ][ value bytes ]
+
+    Вместо трёх выделений (узел из пула + куча под ключ + куча под значение) — одно, из класса
+    размеров SlabAllocator, а хеш, длины и ключ при поиске читаются из одной-двух соседних кэш-линий.
+    Счётчик refs: одна ссылка принадлежит таблице (снимается после отложенного освобождения),
+    остальные — выданным PackedValueHandle.
+    Хвост ExpiryLink есть только у ключей с TTL (флаг kHasExpiry): узлы без срока жизни не растут.
+    Счётчики, записанные INCR/DECR, хранят число ещё и неупакованным (флаг kHasInteger): следующий
+    INCR берёт его как есть, а текст остаётся рядом, чтобы GET отдавал байты без форматирования.
+    Крупные значения могут храниться сжатыми (флаг kCompressed): байты значения — тогда результат
+    lz::pack, а исходные байты даёт plain_value().
+*/
+struct PackedNode;
+
+// Срок жизни ключа и звенья интрузивного списка слота ExpiryWheel.
+struct ExpiryLink {
+    std::atomic<std::uint64_t> deadline;  // мс монотонных часов (now_ms); читатели проверяют без блокировки
+    PackedNode* next;                     // сосед по слоту колеса (только под блокировкой писателя)
+    PackedNode** pprev;                   // ссылка, указывающая на этот узел; nullptr — узел не в колесе
+};
+
+struct PackedNode {
+    static constexpr std::uint8_t kHasExpiry = 1;
+    static constexpr std::uint8_t kHasInteger = 2;
+    static constexpr std::uint8_t kCompressed = 4;
+
+    std::atomic<PackedNode*> next;
+    std::uint64_t hash;
+    std::atomic<std::uint32_t> refs;
+    std::uint32_t valueLen;
+    std::uint16_t keyLen;
+    std::uint8_t flags;
+    std::atomic<std::uint32_t> access;  // метка LRU/LFU (eviction.hpp), занимает выравнивание заголовка
+
+    bool has_expiry() const noexcept { return (flags & kHasExpiry) != 0; }
+    bool has_integer() const noexcept { return (flags & kHasInteger) != 0; }
+    bool compressed() const noexcept { return (flags & kCompressed) != 0; }
+
+    ExpiryLink& expiry() noexcept { return *reinterpret_cast<ExpiryLink*>(this + 1); }
+    const ExpiryLink& expiry() const noexcept { return *reinterpret_cast<const ExpiryLink*>(this + 1); }
+
+    // 0 — ключ бессрочный.
+    std::uint64_t deadline() const noexcept {
+        return has_expiry() ? expiry().deadline.load(std::memory_order_relaxed) : 0;
+    }
+
+    // Неупакованное число значения, если узел его хранит.
+    std::optional<std::int64_t> integer() const noexcept {
+        if (!has_integer()) {
+            return std::nullopt;
+        }
+        std::int64_t value;
+        std::memcpy(&value, reinterpret_cast<const char*>(this) + header_size(flags & kHasExpiry), sizeof(value));
+        return value;
+    }
+
+    static size_t header_size(std::uint8_t flags) noexcept {
+        return sizeof(PackedNode) + ((flags & kHasExpiry) ? sizeof(ExpiryLink) : 0) +
+               ((flags & kHasInteger) ? sizeof(std::int64_t) : 0);
+    }
+
+    const char* bytes() const noexcept { return reinterpret_cast<const char*>(this) + header_size(flags); }
+    char* bytes() noexcept { return reinterpret_cast<char*>(this) + header_size(flags); }
+
+    std::string_view key() const noexcept { return {bytes(), keyLen}; }
+    // Байты значения как они хранятся (у сжатого узла — lz::pack).
+    std::string_view value() const noexcept { return {bytes() + keyLen, valueLen}; }
+
+    // Исходное значение: у сжатого узла распаковывается в scratch.
+    std::string_view plain_value(std::string& scratch) const {
+        if (!compressed()) {
+            return value();
+        }
+        lz::unpack(value(), scratch);
+        return scratch;
+    }
+
+    size_t plain_size() const noexcept { return compressed() ? lz::unpacked_size(value()) : valueLen; }
+
+    size_t allocation_size() const noexcept { return header_size(flags) + keyLen + valueLen; }
+
+    // integer — то же значение числом (value тогда — его десятичная запись);
+    // compressed — value уже сжато lz::pack.
+    static PackedNode* create(std::uint64_t hash, std::string_view key, std::string_view value, PackedNode* next,
+                              std::uint64_t deadline = 0, std::optional<std::int64_t> integer = std::nullopt,
+                              bool compressed = false) {
+        std::uint8_t flags = (deadline != 0 ? kHasExpiry : 0) | (integer ? kHasInteger : 0) |
+                             (compressed ? kCompressed : 0);
+        void* raw = SlabAllocator::instance().allocate(header_size(flags) + key.size() + value.size());
+        auto* node = new (raw) PackedNode{next,
+                                          hash,
+                                          1,
+                                          static_cast<std::uint32_t>(value.size()),
+                                          static_cast<std::uint16_t>(key.size()),
+                                          flags,
+                                          0};
+        if (deadline != 0) {
+            new (&node->expiry()) ExpiryLink{deadline, nullptr, nullptr};
+        }
+        if (integer) {
+            std::memcpy(node->bytes() - sizeof(std::int64_t), &*integer, sizeof(std::int64_t));
+        }
+        std::memcpy(node->bytes(), key.data(), key.size());
+        std::memcpy(node->bytes() + key.size(), value.data(), value.size());
+        return node;
+    }
+
+    // Копия узла в плотной ячейке SlabAllocator (дефрагментация): те же флаги и байты, счётчик
+    // ссылок заново, звенья колеса TTL пустые.
+    PackedNode* relocate(PackedNode* nextNode) const {
+        size_t size = allocation_size();
+        void* raw = SlabAllocator::instance().allocate_dense(size);
+        auto* node = new (raw) PackedNode{nextNode, hash, 1, valueLen, keyLen, flags,
+                                          access.load(std::memory_order_relaxed)};
+        size_t tail = sizeof(PackedNode);
+        if (has_expiry()) {
+            new (&node->expiry()) ExpiryLink{deadline(), nullptr, nullptr};
+            tail += sizeof(ExpiryLink);
+        }
+        std::memcpy(reinterpret_cast<char*>(node) + tail, reinterpret_cast<const char*>(this) + tail, size - tail);
+        return node;
+    }
+
+    void retain() const noexcept { const_cast<PackedNode*>(this)->refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() const noexcept {
+        auto* self = const_cast<PackedNode*>(this);
+        if (self->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            size_t size = self->allocation_size();
+            self->~PackedNode();
+            SlabAllocator::instance().deallocate(self, size);
+        }
+    }
+};
+
+static_assert(sizeof(PackedNode) == 32, "PackedNode header must stay within 32 bytes");
+static_assert(sizeof(PackedNode) % alignof(ExpiryLink) == 0, "ExpiryLink must follow PackedNode aligned");
+
+// Закреплённое значение из PackedNode: держит весь узел, отдаёт байты значения как string_view.
+class PackedValueHandle {
+   public:
+    PackedValueHandle() = default;
+    explicit PackedValueHandle(const PackedNode* node) : node_(node) { node_->retain(); }
+
+    PackedValueHandle(const PackedValueHandle& other) : node_(other.node_) {
+        if (node_) node_->retain();
+    }
+    PackedValueHandle(PackedValueHandle&& other) noexcept : node_(std::exchange(other.node_, nullptr)) {}
+    PackedValueHandle& operator=(PackedValueHandle other) noexcept {
+        std::swap(node_, other.node_);
+        return *this;
+    }
+    ~PackedValueHandle() {
+        if (node_) node_->release();
+    }
+
+    explicit operator bool() const noexcept { return node_ != nullptr; }
+
+    // Байты значения как они хранятся: у сжатого значения — lz::pack (см. compressed()).
+    std::string_view value() const noexcept { return node_->value(); }
+
+    bool compressed() const noexcept { return node_->compressed(); }
+
+    // Исходное значение: несжатое — прямо из узла, сжатое — распакованное в scratch.
+    std::string_view plain(std::string& scratch) const { return node_->plain_value(scratch); }
+
+   private:
+    const PackedNode* node_ = nullptr;
+};
+
+// Значение, уже сжатое lz::pack, — для записи в PackedNode без повторного сжатия.
+struct CompressedValue {
+    std::string_view bytes;
+};
+
+// Упакованные узлы применяются для строковых ключа и значения при прозрачном хеше:
+// сравнение ключей идёт по string_view прямо в узле.
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+inline constexpr bool kUsePackedNodes = std::is_same_v<Key, std::string> && std::is_same_v<Value, std::string> &&
+                                        TransparentLookup<Hash, KeyEqual>;
+
+// Байты вне самого объекта (буфер строки и т.п.); для типов без size() — 0.
+template <typename T>
+size_t heap_bytes(const T& v) {
+    if constexpr (requires { v.size(); typename T::value_type; }) {
+        return v.size() * sizeof(typename T::value_type);
+    } else {
+        return 0;
+    }
+}
+
+// Операции HashTable над узлом конкретного формата.
+template <typename Key, typename Value, bool Packed>
+struct NodeTraits;
+
+template <typename Key, typename Value>
+struct NodeTraits<Key, Value, false> {
+    using Node = HashNode<Key, Value>;
+    using Handle = ValueHandle<Value>;
+
+    static const Key& key(const Node* node) { return node->key; }
+
+    template <typename Hash>
+    static size_t hash(const Node* node, const Hash& hash) { return hash(node->key); }
+    static bool hash_matches(const Node*, size_t) { return true; }
+
+    // Память узла для учёта бюджета: блок пула, блок make_shared со значением и буферы ключа/значения.
+    static size_t footprint(const MemoryPool& pool, const Node* node) {
+        return pool.block_size() + sizeof(Value) + 2 * sizeof(void*) + heap_bytes(node->key) +
+               heap_bytes(*node->value);
+    }
+    // Часть footprint, которую занимают сами байты ключа и значения.
+    static size_t payload(const Node* node) { return heap_bytes(node->key) + heap_bytes(*node->value); }
+
+    static Value copy_value(const Node* node) { return *node->value; }
+    static Handle pin(const Node* node) { return Handle(node->value); }
+
+    // Текущее значение для HashTable::update. Числа HashNode не хранит отдельно.
+    static const Value& view(const Node* node, std::string&) { return *node->value; }
+    static std::optional<std::int64_t> integer(const Node*) { return std::nullopt; }
+
+    template <typename K, typename V>
+    static Node* create(MemoryPool& pool, size_t, const K& key, const V& value, Node* next) {
+        void* rawNode = pool.allocate();
+        return new (rawNode) Node{Key(key), std::make_shared<const Value>(value), next};
+    }
+
+    static void destroy(MemoryPool& pool, Node* node) {
+        node->~Node();
+        pool.deallocate(node);
+    }
+
+    // Дефрагментация пула узлов таблицы: копия узла делит с ним блок значения.
+    static bool fragmented(const MemoryPool& pool) { return pool.fragmented(); }
+    static bool should_relocate(MemoryPool& pool, const Node* node) { return pool.should_relocate(node); }
+    static Node* relocate(MemoryPool& pool, const Node* node) {
+        void* rawNode = pool.allocate_dense();
+        return new (rawNode) Node{node->key, node->value, node->next.load(std::memory_order_relaxed),
+                                  node->access.load(std::memory_order_relaxed)};
+    }
+    static void end_defrag(MemoryPool& pool) { pool.end_defrag(); }
+    static DefragStats defrag_stats(const MemoryPool& pool) { return pool.defrag_stats(); }
+};
+
+template <typename Key, typename Value>
+struct NodeTraits<Key, Value, true> {
+    using Node = PackedNode;
+    using Handle = PackedValueHandle;
+
+    static std::string_view key(const Node* node) { return node->key(); }
+
+    template <typename Hash>
+    static size_t hash(const Node* node, const Hash&) { return static_cast<size_t>(node->hash); }
+    // Кэшированный хеш отсекает почти все несовпадения без сравнения байтов ключа.
+    static bool hash_matches(const Node* node, size_t h) { return node->hash == h; }
+
+    // Вместе с округлением до класса SlabAllocator.
+    static size_t footprint(const MemoryPool&, const Node* node) {
+        return SlabAllocator::allocation_size(node->allocation_size());
+    }
+    static size_t payload(const Node* node) { return node->keyLen + node->valueLen; }
+
+    static Value copy_value(const Node* node) {
+        if (node->compressed()) {
+            Value value;
+            lz::unpack(node->value(), value);
+            return value;
+        }
+        return Value(node->value());
+    }
+    static Handle pin(const Node* node) { return Handle(node); }
+
+    static std::string_view view(const Node* node, std::string& scratch) { return node->plain_value(scratch); }
+    static std::optional<std::int64_t> integer(const Node* node) { return node->integer(); }
+
+    template <typename K, typename V>
+    static Node* create(MemoryPool&, size_t h, const K& key, const V& value, Node* next,
+                        std::uint64_t deadline = 0, std::optional<std::int64_t> integer = std::nullopt,
+                        bool compressed = false) {
+        return PackedNode::create(h, std::string_view(key), std::string_view(value), next, deadline, integer,
+                                  compressed);
+    }
+
+    // Снимает ссылку таблицы; память освободится, когда отпустят и все handle.
+    static void destroy(MemoryPool&, Node* node) { node->release(); }
+
+    // Дефрагментация SlabAllocator. Он общий для всех таблиц, поэтому проход завершает и считает
+    // владелец (Server), а не отдельная таблица.
+    static bool fragmented(const MemoryPool&) { return SlabAllocator::instance().fragmented(); }
+    static bool should_relocate(MemoryPool&, const Node* node) {
+        return SlabAllocator::instance().should_relocate(node, node->allocation_size());
+    }
+    static Node* relocate(MemoryPool&, const Node* node) {
+        return node->relocate(node->next.load(std::memory_order_relaxed));
+    }
+    static void end_defrag(MemoryPool&) {}
+    static DefragStats defrag_stats(const MemoryPool&) { return {}; }
+};
+
+}  // namespace kv
@@ -1,123 +1,465 @@
 // файл: include/kv/hash_table.hpp
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include "allocator.hpp"
+#include "config.hpp"
+#include "kv/epoch.hpp"
+#include "kv/eviction.hpp"
+#include "kv/expiry.hpp"
+#include "kv/hash_node.hpp"
+#include "kv/hash_utils.hpp"
+#include "kv/lz.hpp"
 
 namespace kv {
 
-template <typename Key, typename Value>
-struct HashNode {
-    Key key;
-    Value value;
-    HashNode* next;
+// Односегментная хеш-таблица с цепочками:
+//   - buckets_: массив голов цепочек (степень двойки, индекс = mix_hash & mask)
+//   - oldBuckets_: массив, из которого идёт инкрементальный rehash (nullptr вне rehash)
+//   - tableMutex_: сериализует писателей; читатели его не берут (отключается set_single_writer)
+//   - migrationSeq_: seqlock — нечётен, пока писатель перецепляет узлы между массивами
+//   - retired_: узлы и массивы корзин, ожидающие освобождения (epoch-based reclamation)
+//   - nodePool_: пул для выделения узлов фиксированного размера (HashNode)
+//
+// Формат узла выбирается через NodeTraits: для строковых ключа и значения при прозрачном
+// хеше это PackedNode (одно выделение, кэшированный хеш), иначе — HashNode<Key, Value>.
+//
+// Rehash не останавливает таблицу целиком: при превышении maxLoadFactor_ выделяется
+// новый массив вдвое большего размера, а каждая put/erase переносит в него
+// не более REHASH_BUCKETS_PER_STEP корзин старого. Пока перенос не закончен,
+// поиск заглядывает в оба массива.
+//
+// get() не берёт блокировку: читатель входит в эпоху (EpochGuard), проходит цепочку
+// и, если ключ не найден, сверяет migrationSeq_ — промах во время переноса корзин
+// повторяется. Найденный узел валиден всегда: память удалённых узлов возвращается
+// в пул только после выхода из эпохи всех читателей, которые могли его видеть.
+//
+// Если Hash и KeyEqual прозрачные (is_transparent), get/erase принимают ключ любого
+// совместимого типа, например std::string_view, без построения временного Key.
+//
+// TTL (только для PackedNode): срок хранится в хвосте узла, поэтому бессрочные ключи не растут.
+// Истёкший ключ невидим для читателей сразу (ленивая проверка при поиске); писатель, наткнувшись
+// на него, удаляет его по пути, а остальные вынимает колесо таймеров wheel_ порциями в expire_step.
+//
+// Бюджет памяти (set_max_memory): шард ведёт учёт байтов живых узлов и массивов корзин
+// (служебная часть узлов и ключи со значениями считаются отдельно — см. memory_stats).
+// Если после записи шард превысил бюджет, он вытесняет ключи приближённым LRU/LFU: из
+// EVICTION_SAMPLES ключей случайных корзин удаляется худший по метке доступа. Всё это — под
+// блокировкой самого шарда, и цена одного вытеснения не зависит от числа ключей.
+//
+// Сжатие (PackedNode): значения не короче COMPRESS_MIN_VALUE_SIZE сжимаются lz::pack, если это их
+// уменьшает. put сжимает до взятия блокировки шарда; put_batch и update — под ней. Читатели получают
+// исходные байты через Traits::copy_value / Handle::plain.
+//
+// Активная дефрагментация (defrag_step): проход по корзинам в порядке SCAN, узлы из разреженных арен
+// аллокатора заменяются копиями в плотных — так же, как при перезаписи ключа, поэтому читателям без
+// блокировки ничего не нужно знать о переносе. Блокировка шарда держится одну порцию узлов.
+//
+// update(key, fn) — чтение-изменение-запись под одним взятием блокировки шарда (INCR, APPEND, CAS).
+// Узел всё так же неизменяем: новое значение публикуется новым узлом, который наследует срок
+// жизни и метку доступа старого, так что читатели без блокировки видят либо старое значение,
+// либо новое целиком.
+
+// Блокировка писателей шарда, которую можно отключить, когда с шардом работает единственный
+// поток (режим ядро-на-поток): тогда lock/unlock — только проверка флага.
+class ShardMutex {
+   public:
+    void lock() {
+        if (enabled_) {
+            mutex_.lock();
+        }
+    }
+    void unlock() {
+        if (enabled_) {
+            mutex_.unlock();
+        }
+    }
+
+    // Переключать, пока шард никто не использует.
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+
+   private:
+    std::mutex mutex_;
+    bool enabled_ = true;
 };
 
-// Односегментная хеш-таблица с цепочками:
-//   - capacity_: число bucket’ов
-//   - buckets_: вектор указателей HashNode* (по одному списку на корзину)
-//   - tableMutex_: для защиты при resize всего массива корзин
-//   - nodePool_: пул для выделения узлов
-template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key> >
+// Элемент пакетной операции: хеш ключа уже посчитан, index — позиция ключа в запросе.
+struct BatchSlot {
+    size_t hash;
+    size_t index;
+};
+
+// Разбивка памяти шарда для INFO memory.
+struct MemoryStats {
+    size_t nodes = 0;      // служебная часть узлов: заголовки, указатели, блоки make_shared
+    size_t payload = 0;    // байты ключей и значений (сжатых — в том виде, как хранятся)
+    size_t buckets = 0;    // массивы корзин, включая старый во время rehash
+    size_t poolSlack = 0;  // свободные ячейки пула узлов: память взята у системы, но не занята
+
+    size_t total() const { return nodes + payload + buckets + poolSlack; }
+
+    MemoryStats& operator+=(const MemoryStats& other) {
+        nodes += other.nodes;
+        payload += other.payload;
+        buckets += other.buckets;
+        poolSlack += other.poolSlack;
+        return *this;
+    }
+};
+
+template <typename Key, typename Value, typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key> >
 class HashTable {
+    using Traits = NodeTraits<Key, Value, kUsePackedNodes<Key, Value, Hash, KeyEqual>>;
+    using Node = typename Traits::Node;
+
+    struct Buckets {
+        explicit Buckets(size_t capacity) : heads(capacity) {}
+        size_t capacity() const { return heads.size(); }
+        std::vector<std::atomic<Node*>> heads;
+    };
+
    public:
+    using Handle = typename Traits::Handle;
+
+    static constexpr bool kSupportsExpiry = kUsePackedNodes<Key, Value, Hash, KeyEqual>;
+    static constexpr bool kSupportsCompression = kUsePackedNodes<Key, Value, Hash, KeyEqual>;
+
     HashTable(size_t initial_capacity = 1024)
-        : capacity_(initial_capacity > 0 ? initial_capacity : 1),
-          buckets_(capacity_, nullptr),
+        : capacity_(round_up_pow2(initial_capacity > 0 ? initial_capacity : 1)),
+          buckets_(new Buckets(capacity_)),
           hash_(),
           keyEqual_(),
-          nodePool_(MemoryPool(sizeof(HashNode<Key, Value>), capacity_)),
-          size_(0) {}
+          nodePool_(MemoryPool(sizeof(Node))),
+          size_(0),
+          bucketBytes_(capacity_ * sizeof(std::atomic<Node*>)) {}
 
     ~HashTable() {
-        for (size_t i = 0; i < capacity_; ++i) {
-            HashNode<Key, Value>* node = buckets_[i];
-            while (node) {
-                HashNode<Key, Value>* next = node->next;
-                node->~HashNode<Key, Value>();
-                nodePool_.deallocate(node);
-                node = next;
-            }
-        }
+        retired_.drain();
+        free_chains(buckets_.load());
+        free_chains(oldBuckets_.load());
+        delete buckets_.load();
+        delete oldBuckets_.load();
     }
 
-    bool put(const Key& key, const Value& value) {
-        std::unique_lock lock(tableMutex_);
-        size_t idx = hash_(key) % capacity_;
+    bool put(const Key& key, const Value& value) { return put_impl(key, value); }
 
-        HashNode<Key, Value>* node = buckets_[idx];
-        while (node) {
-            if (keyEqual_(node->key, key)) {
-                node->value = value;
-                return true;
+    // Вставка по ключу/значению совместимых типов (например, string_view из буфера приёма):
+    // упакованный узел копирует байты сразу к себе, без промежуточных std::string.
+    template <typename K, typename V>
+        requires TransparentLookup<Hash, KeyEqual> && std::is_constructible_v<Key, const K&> &&
+                 std::is_constructible_v<Value, const V&>
+    bool put(const K& key, const V& value) {
+        return put_impl(key, value);
+    }
+
+    // Вставка со сроком жизни: deadlineMs — момент истечения по now_ms().
+    template <typename K, typename V>
+        requires kSupportsExpiry && std::is_constructible_v<Key, const K&> && std::is_constructible_v<Value, const V&>
+    bool put(const K& key, const V& value, std::uint64_t deadlineMs) {
+        return put_impl(key, value, deadlineMs);
+    }
+
+    std::optional<Value> get(const Key& key) const { return get_impl(key); }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    std::optional<Value> get(const K& key) const {
+        return get_impl(key);
+    }
+
+    // Чтение без копирования значения: возвращает закреплённый буфер (пустой handle, если ключа нет).
+    Handle get_ref(const Key& key) const { return get_ref_impl(key); }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    Handle get_ref(const K& key) const {
+        return get_ref_impl(key);
+    }
+
+    bool erase(const Key& key) { return erase_impl(key); }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    bool erase(const K& key) {
+        return erase_impl(key);
+    }
+
+    // Атомарное изменение значения. fn(current, integer) вызывается под блокировкой шарда:
+    //   current — указатель на текущее значение (const Value* или string_view* для PackedNode),
+    //             nullptr, если ключа нет;
+    //   integer — значение числом, если узел хранит его неупакованным (иначе nullopt).
+    // fn возвращает std::optional с новым значением (строкой или std::int64_t) либо nullopt,
+    // чтобы ничего не менять. Возвращает true, если значение записано.
+    template <typename K, typename Fn>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    bool update(const K& key, Fn&& fn) {
+        std::lock_guard lock(tableMutex_);
+        rehash_step();
+
+        size_t h = hash_(key);
+        std::string scratch;  // распакованное текущее значение, затем сжатое новое
+        std::atomic<Node*>* link = find_live_link(key, h);
+        if (!link) {
+            using View = std::remove_cvref_t<decltype(Traits::view(nullptr, scratch))>;
+            auto value = fn(static_cast<const View*>(nullptr), std::optional<std::int64_t>{});
+            if (!value) {
+                return false;
             }
-            node = node->next;
+            if (compress_value(*value, scratch)) {
+                return put_locked(key, CompressedValue{scratch}, h, 0);
+            }
+            return put_locked(key, *value, h, 0);
+        }
+
+        Node* old = link->load(std::memory_order_relaxed);
+        const auto& current = Traits::view(old, scratch);
+        auto value = fn(&current, Traits::integer(old));
+        if (!value) {
+            return false;
         }
+        accessClock_.store(accessClock_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        Node* next = old->next.load(std::memory_order_relaxed);
+        Node* node = compress_value(*value, scratch)
+                         ? make_node(h, Traits::key(old), CompressedValue{scratch}, next, deadline_of(old))
+                         : make_node(h, Traits::key(old), *value, next, deadline_of(old));
+        node->access.store(old->access.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        touch(node);
+        replace_node(link, node);
+        return true;
+    }
 
-        void* rawNode = nodePool_.allocate();
-        auto* newNode = new (rawNode) HashNode<Key, Value>{key, value, buckets_[idx]};
-        buckets_[idx] = newNode;
-        ++size_;
-        bool needRehash = (static_cast<float>(size_) > static_cast<float>(capacity_) * maxLoadFactor_);
-        lock.unlock();
+    // Назначает существующему ключу срок жизни. false — ключа нет (или он уже истёк).
+    template <typename K>
+        requires kSupportsExpiry
+    bool expire(const K& key, std::uint64_t deadlineMs) {
+        return expire_impl(key, deadlineMs);
+    }
 
-        if (needRehash) {
-            rehash();
+    // Оставшееся время жизни в мс: -1 — ключ бессрочный, -2 — ключа нет.
+    template <typename K>
+        requires kSupportsExpiry
+    std::int64_t ttl(const K& key) const {
+        std::optional<std::uint64_t> deadline =
+            read_node<std::optional<std::uint64_t>>(key, [](Node* node) { return std::optional(node->deadline()); });
+        if (!deadline) {
+            return -2;
         }
+        if (*deadline == 0) {
+            return -1;
+        }
+        std::uint64_t now = now_ms();
+        return *deadline > now ? static_cast<std::int64_t>(*deadline - now) : 0;
+    }
 
-        return true;
+    // Активное истечение: удаляет не более budget просроченных ключей за одно взятие блокировки.
+    // true — если в шарде остались просроченные ключи для следующего вызова.
+    bool expire_step(std::uint64_t nowMs, size_t budget)
+        requires kSupportsExpiry
+    {
+        std::lock_guard lock(tableMutex_);
+        return wheel_.advance(
+            nowMs, budget, [](void* ctx, PackedNode* node) { static_cast<HashTable*>(ctx)->unlink_expired(node); },
+            this);
     }
 
-    std::optional<Value> get(const Key& key) const {
-        std::shared_lock lock(tableMutex_);
+    // Один шаг SCAN: обходит корзины с позиции cursor в обратном двоичном порядке и вызывает
+    // fn(key) для каждого живого ключа, пока не наберёт count ключей (или count * 10 пустых
+    // корзин). Возвращает следующий курсор; 0 — обход завершён. Ключ, пролежавший в таблице
+    // весь обход, будет выдан хотя бы раз, даже если между шагами шёл rehash (возможны повторы).
+    // Блокировка шарда держится только на время одного шага.
+    template <typename Fn>
+    std::uint64_t scan(std::uint64_t cursor, size_t count, Fn&& fn) {
+        std::lock_guard lock(tableMutex_);
+        return walk_buckets(cursor, count, [&](std::atomic<Node*>& head) { return visit_bucket(head, fn); });
+    }
 
-        size_t idx = hash_(key) % capacity_;
-        HashNode<Key, Value>* node = buckets_[idx];
-        while (node) {
-            if (keyEqual_(node->key, key)) {
-                return node->value;
+    // Разделение шарда ShardedHashMap. Один шаг переноса: обходит корзины с позиции cursor в том же
+    // порядке, что и SCAN, и переносит в dest узлы, для хеша которых moves(hash) истинно (около count
+    // просмотренных узлов). Узел сначала появляется в dest и только потом исчезает отсюда, поэтому
+    // читатель, который смотрит сюда раньше, чем в dest, ключ не теряет. Возвращает следующий
+    // курсор; 0 — обход закончен. Блокировка dest берётся внутри, после блокировки этого шарда.
+    template <typename Pred>
+    std::uint64_t migrate_step(std::uint64_t cursor, size_t count, Pred&& moves, HashTable& dest) {
+        std::lock_guard lock(tableMutex_);
+        rehash_step();
+        return walk_buckets(cursor, count, [&](std::atomic<Node*>& head) {
+            size_t seen = 0;
+            std::atomic<Node*>* link = &head;
+            while (Node* node = link->load(std::memory_order_relaxed)) {
+                ++seen;
+                size_t h = Traits::hash(node, hash_);
+                if (!moves(h)) {
+                    link = &node->next;
+                    continue;
+                }
+                if (!is_expired(node)) {
+                    dest.adopt(node, h);
+                }
+                unlink_node(link);
+            }
+            return seen;
+        });
+    }
+
+    // Перенос одного ключа в dest (запись в ключ, чей шард сейчас разделяется).
+    template <typename K>
+    void move_key(const K& key, HashTable& dest) {
+        std::lock_guard lock(tableMutex_);
+        size_t h = hash_(key);
+        std::atomic<Node*>* link = find_live_link(key, h);
+        if (link) {
+            dest.adopt(link->load(std::memory_order_relaxed), h);
+            unlink_node(link);
+        }
+    }
+
+    // Пакетные операции для ShardedHashMap: slots — ключи этого шарда с уже посчитанными хешами,
+    // slot.index — позиция ключа (и значения, и результата) в запросе. Сначала выдаётся prefetch
+    // голов корзин всех ключей, затем идёт поиск — промахи кэша по разным корзинам перекрываются.
+    // Эпоха (для чтения) или блокировка шарда (для записи) берётся один раз на всю группу.
+    template <typename K>
+    void get_ref_batch(std::span<const K> keys, std::span<const BatchSlot> slots, Handle* out) const {
+        EpochGuard guard;
+        prefetch_buckets(slots);
+        for (const BatchSlot& slot : slots) {
+            out[slot.index] =
+                read_node<Handle>(keys[slot.index], slot.hash, [](Node* node) { return Traits::pin(node); });
+        }
+    }
+
+    template <typename K, typename V>
+    void put_batch(std::span<const K> keys, std::span<const V> values, std::span<const BatchSlot> slots) {
+        std::vector<std::string> packed(slots.size());  // сжатые значения; пустая строка — хранится как есть
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (!compress_value(values[slots[i].index], packed[i])) {
+                packed[i].clear();
+            }
+        }
+        std::lock_guard lock(tableMutex_);
+        prefetch_buckets(slots);
+        for (size_t i = 0; i < slots.size(); ++i) {
+            const BatchSlot& slot = slots[i];
+            if (!packed[i].empty()) {
+                put_locked(keys[slot.index], CompressedValue{packed[i]}, slot.hash, 0);
+            } else {
+                put_locked(keys[slot.index], values[slot.index], slot.hash, 0);
             }
-            node = node->next;
         }
-        return std::nullopt;
     }
 
-    bool erase(const Key& key) {
-        std::unique_lock lock(tableMutex_);
+    template <typename K>
+    size_t erase_batch(std::span<const K> keys, std::span<const BatchSlot> slots) {
+        std::lock_guard lock(tableMutex_);
+        prefetch_buckets(slots);
+        size_t erased = 0;
+        for (const BatchSlot& slot : slots) {
+            erased += erase_locked(keys[slot.index], slot.hash);
+        }
+        return erased;
+    }
+
+    size_t size() { return size_.load(std::memory_order_relaxed); }
 
-        size_t idx = hash_(key) % capacity_;
-        HashNode<Key, Value>* node = buckets_[idx];
-        HashNode<Key, Value>* prev = nullptr;
+    // Идёт инкрементальный rehash: ключи лежат в двух массивах корзин.
+    bool rehashing() const { return oldBuckets_.load(std::memory_order_relaxed) != nullptr; }
 
-        while (node) {
-            if (keyEqual_(node->key, key)) {
-                if (prev == nullptr) {
-                    buckets_[idx] = node->next;
-                } else {
-                    prev->next = node->next;
+    // Шард используется только одним потоком — блокировка писателей не нужна.
+    // Читатели по-прежнему входят в эпоху: выданные handle и отложенное освобождение не меняются.
+    void set_single_writer(bool enabled) { tableMutex_.set_enabled(!enabled); }
+
+    // Бюджет памяти шарда в байтах (0 — без ограничения) и политика вытеснения.
+    void set_max_memory(size_t bytes, kv::config::EvictionPolicy policy) {
+        policy_.store(policy, std::memory_order_relaxed);
+        maxBytes_.store(bytes, std::memory_order_relaxed);
+    }
+
+    // Учтённая память шарда: живые узлы вместе с ключами и значениями плюс массивы корзин.
+    size_t memory_usage() const {
+        return nodeBytes_.load(std::memory_order_relaxed) + payloadBytes_.load(std::memory_order_relaxed) +
+               bucketBytes_.load(std::memory_order_relaxed);
+    }
+
+    // Память одного ключа (узел вместе с ключом и значением); nullopt — ключа нет.
+    template <typename K>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    std::optional<size_t> memory_usage(const K& key) const {
+        return read_node<std::optional<size_t>>(
+            key, [this](Node* node) { return std::optional<size_t>(Traits::footprint(nodePool_, node)); });
+    }
+
+    // Возвращает системе пустые арены пула узлов (HashNode; PackedNode берёт память у SlabAllocator).
+    size_t trim_memory() { return nodePool_.trim(); }
+
+    // Один шаг дефрагментации: около count узлов с позиции прошлого шага, за одно взятие блокировки.
+    // Узел, который аллокатор просит убрать из разреженной арены, заменяется копией в плотной.
+    // false — проход по таблице закончен (или аллокатору он не нужен); следующий начнётся после
+    // defrag_rewind.
+    bool defrag_step(size_t count) {
+        std::lock_guard lock(tableMutex_);
+        if (defragDone_ || (defragCursor_ == 0 && !Traits::fragmented(nodePool_))) {
+            return false;
+        }
+        defragCursor_ = walk_buckets(defragCursor_, count, [&](std::atomic<Node*>& head) {
+            size_t seen = 0;
+            for (std::atomic<Node*>* link = &head; Node* node = link->load(std::memory_order_relaxed);
+                 link = &link->load(std::memory_order_relaxed)->next) {
+                ++seen;
+                if (!is_expired(node) && Traits::should_relocate(nodePool_, node)) {
+                    relocate_node(link);
                 }
-                node->~HashNode<Key, Value>();
-                nodePool_.deallocate(node);
-                --size_;
-                return true;
             }
-            prev = node;
-            node = node->next;
+            return seen;
+        });
+        if (defragCursor_ != 0) {
+            return true;
         }
+        defragDone_ = true;
+        retired_.reclaim();  // старые копии узлов держат осушаемые арены
+        Traits::end_defrag(nodePool_);
         return false;
     }
-    size_t size() { return size_; }
+
+    void defrag_rewind() {
+        std::lock_guard lock(tableMutex_);
+        defragDone_ = false;
+    }
+
+    // Перенесённые узлы пула этой таблицы (узлы PackedNode считает SlabAllocator).
+    DefragStats defrag_stats() const { return Traits::defrag_stats(nodePool_); }
+
+    // Счётчики ведутся при каждой записи, так что запрос не обходит узлы.
+    MemoryStats memory_stats() const {
+        return {nodeBytes_.load(std::memory_order_relaxed), payloadBytes_.load(std::memory_order_relaxed),
+                bucketBytes_.load(std::memory_order_relaxed), nodePool_.free_bytes()};
+    }
+
+    // Сколько ключей вытеснено из-за бюджета памяти (истёкшие по TTL не считаются).
+    std::uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
 
    private:
-    size_t capacity_;
-    std::vector<HashNode<Key, Value>*> buckets_;
+    size_t capacity_;  // ёмкость buckets_, читается только писателями
+    std::atomic<Buckets*> buckets_;
 
-    mutable std::shared_mutex tableMutex_;
+    // Состояние инкрементального rehash: корзины oldBuckets_ с индексом < rehashIndex_ уже перенесены.
+    std::atomic<Buckets*> oldBuckets_{nullptr};
+    size_t rehashIndex_ = 0;
+    std::atomic<std::uint64_t> migrationSeq_{0};
+
+    ShardMutex tableMutex_;
+    RetireList retired_;
 
     Hash hash_;
     KeyEqual keyEqual_;
@@ -125,28 +467,623 @@ class HashTable {
     MemoryPool nodePool_;
 
     float maxLoadFactor_ = 0.75f;
-    size_t size_;
+    std::atomic<size_t> size_;
+
+    // Учёт памяти и вытеснение. accessClock_ — логические часы шарда для меток доступа:
+    // растут с каждой записью, читатели их только читают.
+    std::atomic<size_t> bucketBytes_;
+    std::atomic<size_t> nodeBytes_{0};     // footprint живых узлов без payloadBytes_
+    std::atomic<size_t> payloadBytes_{0};  // байты ключей и значений живых узлов
+    std::atomic<size_t> maxBytes_{0};
+    std::atomic<kv::config::EvictionPolicy> policy_{kv::config::EVICTION_POLICY};
+    std::atomic<std::uint32_t> accessClock_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+    std::uint64_t sampleRng_ = 0x2545F4914F6CDD1DULL;  // выбор корзин для вытеснения, только под блокировкой
+
+    // Дефрагментация: курсор прохода (как у SCAN) и признак, что проход закончен. Под блокировкой.
+    std::uint64_t defragCursor_ = 0;
+    bool defragDone_ = false;
+
+    // Колесо таймеров ключей с TTL; для HashNode не используется.
+    std::conditional_t<kSupportsExpiry, ExpiryWheel, std::monostate> wheel_;
+
+    // Ищет узел без блокировки и вызывает onFound(node) внутри эпохи; при промахе возвращает Result{}.
+    template <typename Result, typename K, typename Fn>
+    Result read_node(const K& key, Fn&& onFound) const {
+        return read_node<Result>(key, hash_(key), std::forward<Fn>(onFound));
+    }
+
+    template <typename Result, typename K, typename Fn>
+    Result read_node(const K& key, size_t h, Fn&& onFound) const {
+        EpochGuard guard;
+        while (true) {
+            std::uint64_t seq = migrationSeq_.load(std::memory_order_acquire);
+            if ((seq & 1) == 0) {
+                if (Node* node = find_node(key, h)) {
+                    if (is_expired(node)) {
+                        return Result{};
+                    }
+                    touch(node);
+                    return onFound(node);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (migrationSeq_.load(std::memory_order_relaxed) == seq) {
+                    return Result{};
+                }
+            }
+            // Писатель как раз перецепляет корзины — промах мог быть ложным.
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename K>
+    std::optional<Value> get_impl(const K& key) const {
+        return read_node<std::optional<Value>>(key,
+                                               [](Node* node) { return std::optional<Value>(Traits::copy_value(node)); });
+    }
+
+    template <typename K>
+    Handle get_ref_impl(const K& key) const {
+        return read_node<Handle>(key, [](Node* node) { return Traits::pin(node); });
+    }
+
+    template <typename K, typename V>
+    bool put_impl(const K& key, const V& value, std::uint64_t deadlineMs = 0) {
+        // Сжатие — до блокировки шарда: другие писатели его не ждут.
+        thread_local std::string packed;
+        if (compress_value(value, packed)) {
+            std::lock_guard lock(tableMutex_);
+            return put_locked(key, CompressedValue{packed}, hash_(key), deadlineMs);
+        }
+        std::lock_guard lock(tableMutex_);
+        return put_locked(key, value, hash_(key), deadlineMs);
+    }
+
+    // Сжимает крупное строковое значение в out (lz::pack). false — не сжимается: таблица без
+    // PackedNode, значение короче COMPRESS_MIN_VALUE_SIZE или сжатие его не уменьшает.
+    template <typename V>
+    static bool compress_value(const V& value, std::string& out) {
+        if constexpr (kSupportsCompression && std::is_convertible_v<const V&, std::string_view>) {
+            std::string_view bytes(value);
+            return kv::config::COMPRESS_MIN_VALUE_SIZE != 0 && bytes.size() >= kv::config::COMPRESS_MIN_VALUE_SIZE &&
+                   lz::pack(bytes, out);
+        } else {
+            return false;
+        }
+    }
+
+    template <typename K, typename V>
+    bool put_locked(const K& key, const V& value, size_t h, std::uint64_t deadlineMs) {
+        rehash_step();
+
+        accessClock_.store(accessClock_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        std::atomic<Node*>* link = find_live_link(key, h);
+        if (link) {
+            // Новый узел заменяет старый целиком, вместе со сроком жизни (SET без срока снимает TTL).
+            Node* old = link->load(std::memory_order_relaxed);
+            replace_node(link, make_node(h, key, value, old->next.load(std::memory_order_relaxed), deadlineMs));
+            return true;
+        }
+
+        insert_node(h, make_node(h, key, value, nullptr, deadlineMs));
+        return true;
+    }
+
+    // Вставляет узел нового (отсутствующего в таблице) ключа в голову корзины.
+    // Вызывается под блокировкой писателя.
+    void insert_node(size_t h, Node* node) {
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        std::atomic<Node*>& head = cur->heads[bucket_index(h, cur->capacity())];
+        node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        head.store(node, std::memory_order_release);
+        track_expiry(node);
+        account(node, nullptr);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        evict_if_needed(node);
+
+        // Решение о rehash и его старт происходят под той же блокировкой,
+        // поэтому два писателя не могут запустить его дважды.
+        if (!rehashing() &&
+            static_cast<float>(size_.load(std::memory_order_relaxed)) > static_cast<float>(capacity_) * maxLoadFactor_) {
+            start_rehash();
+        }
+    }
+
+    // Принимает копию узла другой таблицы (перенос при разделении шарда) вместе со сроком жизни,
+    // числом и меткой доступа. Если ключ здесь уже есть, он записан позже — копия не нужна.
+    void adopt(const Node* src, size_t h) {
+        std::lock_guard lock(tableMutex_);
+        rehash_step();
+        if (find_live_link(Traits::key(src), h)) {
+            return;
+        }
+        insert_node(h, clone_node(src, h, nullptr, deadline_of(src)));
+    }
+
+    // Копия узла (в том числе сжатого или с числом) с другим сроком жизни и соседом по цепочке.
+    Node* clone_node(const Node* src, size_t h, Node* next, std::uint64_t deadlineMs) {
+        Node* node;
+        if constexpr (kSupportsExpiry) {
+            node = Traits::create(nodePool_, h, src->key(), src->value(), next, deadlineMs, src->integer(),
+                                  src->compressed());
+        } else {
+            node = Traits::create(nodePool_, h, src->key, *src->value, next);
+        }
+        node->access.store(src->access.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return node;
+    }
+
+    template <typename K>
+    bool erase_impl(const K& key) {
+        std::lock_guard lock(tableMutex_);
+        return erase_locked(key, hash_(key));
+    }
 
-    void rehash() {
-        std::unique_lock lock(tableMutex_);
+    template <typename K>
+    bool erase_locked(const K& key, size_t h) {
+        rehash_step();
 
-        size_t newCapacity = capacity_ * 2;
-        std::vector<HashNode<Key, Value>*> newBuckets(newCapacity, nullptr);
+        std::atomic<Node*>* link = find_live_link(key, h);
+        if (!link) {
+            return false;
+        }
+        unlink_node(link);
+        return true;
+    }
+
+    template <typename K>
+    bool expire_impl(const K& key, std::uint64_t deadlineMs) {
+        std::lock_guard lock(tableMutex_);
+        rehash_step();
+
+        size_t h = hash_(key);
+        std::atomic<Node*>* link = find_live_link(key, h);
+        if (!link) {
+            return false;
+        }
+        Node* node = link->load(std::memory_order_relaxed);
+        if (node->has_expiry()) {
+            // Место под срок уже есть: читатели увидят новый deadline атомарно.
+            wheel_.remove(node);
+            node->expiry().deadline.store(deadlineMs, std::memory_order_relaxed);
+            wheel_.insert(node);
+            return true;
+        }
+        // У бессрочного узла нет хвоста ExpiryLink — подменяем его копией с хвостом.
+        Node* copy = clone_node(node, h, node->next.load(std::memory_order_relaxed), deadlineMs);
+        link->store(copy, std::memory_order_release);
+        wheel_.insert(copy);
+        account(copy, node);
+        retire_node(node);
+        return true;
+    }
+
+    // Подменяет узел по ссылке link новым (с тем же ключом). Вызывается под блокировкой писателя.
+    void replace_node(std::atomic<Node*>* link, Node* node) {
+        Node* old = link->load(std::memory_order_relaxed);
+        link->store(node, std::memory_order_release);
+        forget_expiry(old);
+        track_expiry(node);
+        account(node, old);
+        retire_node(old);
+        evict_if_needed(node);
+    }
+
+    // Заменяет узел копией в другой ячейке аллокатора (дефрагментация). Ключ, значение, срок жизни и
+    // метка доступа те же, так что учёт памяти не меняется. Вызывается под блокировкой писателя.
+    void relocate_node(std::atomic<Node*>* link) {
+        Node* old = link->load(std::memory_order_relaxed);
+        Node* copy = Traits::relocate(nodePool_, old);
+        link->store(copy, std::memory_order_release);
+        forget_expiry(old);
+        track_expiry(copy);
+        retire_node(old);
+    }
+
+    static std::uint64_t deadline_of(const Node* node) {
+        if constexpr (kSupportsExpiry) {
+            return node->deadline();
+        } else {
+            return 0;
+        }
+    }
+
+    static bool is_expired(const Node* node) {
+        if constexpr (kSupportsExpiry) {
+            return node->has_expiry() && node->deadline() <= now_ms();
+        } else {
+            return false;
+        }
+    }
+
+    // find_link для писателей с ленивым истечением: просроченный узел удаляется по пути
+    // и считается отсутствующим.
+    template <typename K>
+    std::atomic<Node*>* find_live_link(const K& key, size_t h) {
+        std::atomic<Node*>* link = find_link(key, h);
+        if (link && is_expired(link->load(std::memory_order_relaxed))) {
+            unlink_node(link);
+            return nullptr;
+        }
+        return link;
+    }
+
+    // Отцепляет узел, на который указывает link. Вызывается под блокировкой писателя.
+    void unlink_node(std::atomic<Node*>* link) {
+        Node* node = link->load(std::memory_order_relaxed);
+        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        forget_expiry(node);
+        account(nullptr, node);
+        retire_node(node);
+    }
+
+    // Вызывается внутри эпохи или под блокировкой писателя, так что массив корзин жив.
+    void prefetch_buckets(std::span<const BatchSlot> slots) const {
+        Buckets* cur = buckets_.load(std::memory_order_acquire);
+        for (const BatchSlot& slot : slots) {
+            prefetch(&cur->heads[bucket_index(slot.hash, cur->capacity())]);
+        }
+    }
+
+    // Обход корзин для scan/migrate_step: visit(head) обрабатывает одну корзину и возвращает
+    // число просмотренных в ней узлов. Вызывается под блокировкой писателя.
+    template <typename Visit>
+    std::uint64_t walk_buckets(std::uint64_t cursor, size_t count, Visit&& visit) {
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        Buckets* old = oldBuckets_.load(std::memory_order_relaxed);
+
+        size_t visited = 0;
+        size_t emptyLeft = count * 10;
+        do {
+            size_t found = 0;
+            if (!old) {
+                std::uint64_t mask = cur->capacity() - 1;
+                found = visit(cur->heads[cursor & mask]);
+                cursor = scan_cursor_next(cursor, mask);
+            } else {
+                // Идёт rehash: корзина меньшего (старого) массива и все корзины большего,
+                // на которые она раскладывается. Перенесённые корзины старого массива пусты.
+                std::uint64_t m0 = old->capacity() - 1;
+                std::uint64_t m1 = cur->capacity() - 1;
+                found = visit(old->heads[cursor & m0]);
+                std::uint64_t v = cursor;
+                do {
+                    found += visit(cur->heads[v & m1]);
+                    v = (((v | m0) + 1) & ~m0) | (v & m0);
+                } while (v & (m0 ^ m1));
+                cursor = scan_cursor_next(cursor, m0);
+            }
+            visited += found;
+            if (found == 0 && --emptyLeft == 0) {
+                break;
+            }
+        } while (cursor != 0 && visited < count);
+        return cursor;
+    }
+
+    template <typename Fn>
+    size_t visit_bucket(std::atomic<Node*>& head, Fn& fn) {
+        size_t found = 0;
+        for (Node* node = head.load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed)) {
+            if (!is_expired(node)) {
+                fn(Traits::key(node));
+                ++found;
+            }
+        }
+        return found;
+    }
+
+    void account(const Node* added, const Node* removed) {
+        size_t nodes = nodeBytes_.load(std::memory_order_relaxed);
+        size_t payload = payloadBytes_.load(std::memory_order_relaxed);
+        if (added) {
+            nodes += Traits::footprint(nodePool_, added) - Traits::payload(added);
+            payload += Traits::payload(added);
+        }
+        if (removed) {
+            nodes -= Traits::footprint(nodePool_, removed) - Traits::payload(removed);
+            payload -= Traits::payload(removed);
+        }
+        nodeBytes_.store(nodes, std::memory_order_relaxed);
+        payloadBytes_.store(payload, std::memory_order_relaxed);
+    }
+
+    // Метка доступа обновляется, только когда бюджет задан: без него вытеснения нет.
+    void touch(Node* node) const {
+        if (maxBytes_.load(std::memory_order_relaxed) != 0) {
+            access_stamp::touch(node->access, accessClock_.load(std::memory_order_relaxed),
+                                policy_.load(std::memory_order_relaxed));
+        }
+    }
+
+    // Вытесняет ключи, пока узлы шарда с ключами и значениями превышают бюджет. Массивы корзин
+    // в бюджет не входят: одни они могут его превысить (малый maxmemory, рост при rehash), и
+    // вытеснение тогда удалило бы все ключи. Только что записанный узел keep не трогаем; если
+    // выборка не нашла другого кандидата, вытеснение останавливается.
+    void evict_if_needed(const Node* keep) {
+        size_t limit = maxBytes_.load(std::memory_order_relaxed);
+        if (limit == 0) {
+            return;
+        }
+        while (nodeBytes_.load(std::memory_order_relaxed) + payloadBytes_.load(std::memory_order_relaxed) > limit) {
+            std::atomic<Node*>* victim = sample_victim(keep);
+            if (!victim) {
+                return;
+            }
+            bool expired = is_expired(victim->load(std::memory_order_relaxed));
+            unlink_node(victim);
+            if (!expired) {
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Просматривает до EVICTION_SAMPLES ключей из случайных корзин и возвращает ссылку на лучший
+    // по политике кандидат (истёкший по TTL — сразу). Число просмотренных корзин ограничено,
+    // поэтому цена не зависит от размера шарда.
+    std::atomic<Node*>* sample_victim(const Node* keep) {
+        constexpr size_t kSamples = kv::config::EVICTION_SAMPLES;
+        std::uint32_t clock = accessClock_.load(std::memory_order_relaxed);
+        kv::config::EvictionPolicy policy = policy_.load(std::memory_order_relaxed);
+
+        std::atomic<Node*>* best = nullptr;
+        std::uint64_t bestScore = 0;
+        size_t seen = 0;
+        for (size_t probe = 0; probe < kSamples * 8 && seen < kSamples; ++probe) {
+            std::atomic<Node*>* link = &random_bucket();
+            for (Node* node = link->load(std::memory_order_relaxed); node && seen < kSamples;
+                 link = &node->next, node = link->load(std::memory_order_relaxed)) {
+                if (node == keep) {
+                    continue;
+                }
+                if (is_expired(node)) {
+                    return link;
+                }
+                std::uint64_t score =
+                    access_stamp::victim_score(node->access.load(std::memory_order_relaxed), clock, policy);
+                if (!best || score > bestScore) {
+                    best = link;
+                    bestScore = score;
+                }
+                ++seen;
+            }
+        }
+        return best;
+    }
+
+    // Случайная корзина среди тех, где могут лежать узлы: текущий массив или ещё не перенесённая
+    // часть старого.
+    std::atomic<Node*>& random_bucket() {
+        sampleRng_ ^= sampleRng_ << 13;
+        sampleRng_ ^= sampleRng_ >> 7;
+        sampleRng_ ^= sampleRng_ << 17;
+        std::uint64_t r = sampleRng_;
+        Buckets* old = oldBuckets_.load(std::memory_order_relaxed);
+        if (old && (r & 1)) {
+            return old->heads[rehashIndex_ + static_cast<size_t>(r >> 1) % (old->capacity() - rehashIndex_)];
+        }
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        return cur->heads[static_cast<size_t>(r >> 1) & (cur->capacity() - 1)];
+    }
+
+    // Узел, вынутый колесом: ищем ссылку на него по кэшированному хешу и сравнению указателей.
+    void unlink_expired(Node* node) {
+        size_t h = Traits::hash(node, hash_);
+        if (Buckets* old = oldBuckets_.load(std::memory_order_relaxed)) {
+            size_t oldIdx = bucket_index(h, old->capacity());
+            if (oldIdx >= rehashIndex_) {
+                if (auto* link = find_link_to(old->heads[oldIdx], node)) {
+                    unlink_node(link);
+                    return;
+                }
+            }
+        }
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        if (auto* link = find_link_to(cur->heads[bucket_index(h, cur->capacity())], node)) {
+            unlink_node(link);
+        }
+    }
+
+    static std::atomic<Node*>* find_link_to(std::atomic<Node*>& head, const Node* target) {
+        std::atomic<Node*>* link = &head;
+        Node* node = link->load(std::memory_order_relaxed);
+        while (node) {
+            if (node == target) {
+                return link;
+            }
+            link = &node->next;
+            node = link->load(std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+
+    void track_expiry(Node* node) {
+        if constexpr (kSupportsExpiry) {
+            if (node->has_expiry()) {
+                wheel_.insert(node);
+            }
+        }
+    }
+
+    void forget_expiry(Node* node) {
+        if constexpr (kSupportsExpiry) {
+            if (node->has_expiry()) {
+                wheel_.remove(node);
+            }
+        }
+    }
+
+    static size_t bucket_index(size_t h, size_t capacity) {
+        return static_cast<size_t>(mix_hash(h)) & (capacity - 1);
+    }
+
+    // Значение — строка (или Value) либо std::int64_t: число записывается десятичным текстом,
+    // а PackedNode вдобавок хранит его неупакованным для следующего INCR.
+    template <typename K, typename V>
+    Node* make_node(size_t h, const K& key, const V& value, Node* next, std::uint64_t deadlineMs = 0) {
+        Node* node;
+        if constexpr (std::is_same_v<V, std::int64_t>) {
+            char text[24];
+            char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+            std::string_view digits(text, static_cast<size_t>(end - text));
+            if constexpr (kSupportsExpiry) {
+                node = Traits::create(nodePool_, h, key, digits, next, deadlineMs, value);
+            } else {
+                node = Traits::create(nodePool_, h, key, Value(digits), next);
+            }
+        } else if constexpr (std::is_same_v<V, CompressedValue>) {
+            if constexpr (kSupportsCompression) {
+                node = Traits::create(nodePool_, h, key, value.bytes, next, deadlineMs, std::nullopt, true);
+            } else {
+                std::unreachable();  // compress_value сжимает только значения PackedNode
+            }
+        } else if constexpr (kSupportsExpiry) {
+            node = Traits::create(nodePool_, h, key, value, next, deadlineMs);
+        } else {
+            node = Traits::create(nodePool_, h, key, value, next);
+        }
+        node->access.store(access_stamp::make(accessClock_.load(std::memory_order_relaxed), access_stamp::kLfuInit),
+                           std::memory_order_relaxed);
+        return node;
+    }
+
+    void destroy_node(Node* node) { Traits::destroy(nodePool_, node); }
+
+    void retire_node(Node* node) {
+        retired_.retire(
+            node, [](void* ctx, void* ptr) { static_cast<HashTable*>(ctx)->destroy_node(static_cast<Node*>(ptr)); },
+            this);
+        if (retired_.pending() >= kv::config::EPOCH_RECLAIM_BATCH) {
+            retired_.reclaim();
+        }
+    }
+
+    template <typename K>
+    Node* find_in_chain(Node* node, const K& key, size_t h) const {
+        while (node) {
+            if (Traits::hash_matches(node, h) && keyEqual_(Traits::key(node), key)) {
+                return node;
+            }
+            node = node->next.load(std::memory_order_acquire);
+        }
+        return nullptr;
+    }
 
-        for (size_t i = 0; i < capacity_; ++i) {
-            HashNode<Key, Value>* node = buckets_[i];
+    // Поиск без блокировки: сначала старый массив (если идёт rehash), затем текущий.
+    // Порядок загрузок важен: start_rehash публикует oldBuckets_ раньше buckets_.
+    template <typename K>
+    Node* find_node(const K& key, size_t h) const {
+        Buckets* cur = buckets_.load(std::memory_order_acquire);
+        Buckets* old = oldBuckets_.load(std::memory_order_acquire);
+        if (old) {
+            Node* head = old->heads[bucket_index(h, old->capacity())].load(std::memory_order_acquire);
+            if (Node* node = find_in_chain(head, key, h)) {
+                return node;
+            }
+        }
+        Node* head = cur->heads[bucket_index(h, cur->capacity())].load(std::memory_order_acquire);
+        return find_in_chain(head, key, h);
+    }
+
+    // Возвращает ссылку (голову корзины или next предыдущего узла), указывающую на узел с ключом.
+    // Только для писателей.
+    template <typename K>
+    std::atomic<Node*>* find_link(const K& key, size_t h) {
+        if (Buckets* old = oldBuckets_.load(std::memory_order_relaxed)) {
+            size_t oldIdx = bucket_index(h, old->capacity());
+            if (oldIdx >= rehashIndex_) {
+                if (auto* link = find_link_in_chain(old->heads[oldIdx], key, h)) {
+                    return link;
+                }
+            }
+        }
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        return find_link_in_chain(cur->heads[bucket_index(h, cur->capacity())], key, h);
+    }
+
+    template <typename K>
+    std::atomic<Node*>* find_link_in_chain(std::atomic<Node*>& head, const K& key, size_t h) {
+        std::atomic<Node*>* link = &head;
+        Node* node = link->load(std::memory_order_relaxed);
+        while (node) {
+            if (Traits::hash_matches(node, h) && keyEqual_(Traits::key(node), key)) {
+                return link;
+            }
+            link = &node->next;
+            node = link->load(std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+
+    void free_chains(Buckets* buckets) {
+        if (!buckets) {
+            return;
+        }
+        for (auto& head : buckets->heads) {
+            Node* node = head.load(std::memory_order_relaxed);
             while (node) {
-                HashNode<Key, Value>* next = node->next;
-                size_t newIdx = hash_(node->key) % newCapacity;
-                node->next = newBuckets[newIdx];
-                newBuckets[newIdx] = node;
+                Node* next = node->next.load(std::memory_order_relaxed);
+                destroy_node(node);
                 node = next;
             }
         }
+    }
 
-        capacity_ = newCapacity;
-        buckets_.swap(newBuckets);
-    };
+    // Секция seqlock: пока она открыта, промахи читателей не считаются окончательными.
+    void begin_migration() {
+        migrationSeq_.store(migrationSeq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void end_migration() {
+        migrationSeq_.store(migrationSeq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Вызывается под блокировкой писателя.
+    void start_rehash() {
+        begin_migration();
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+        capacity_ *= 2;
+        bucketBytes_.fetch_add(capacity_ * sizeof(std::atomic<Node*>), std::memory_order_relaxed);
+        oldBuckets_.store(cur, std::memory_order_release);
+        buckets_.store(new Buckets(capacity_), std::memory_order_release);
+        rehashIndex_ = 0;
+        end_migration();
+    }
+
+    // Переносит не более REHASH_BUCKETS_PER_STEP корзин. Вызывается под блокировкой писателя.
+    void rehash_step() {
+        Buckets* old = oldBuckets_.load(std::memory_order_relaxed);
+        if (!old) {
+            return;
+        }
+        Buckets* cur = buckets_.load(std::memory_order_relaxed);
+
+        begin_migration();
+        size_t limit = std::min(old->capacity(), rehashIndex_ + kv::config::REHASH_BUCKETS_PER_STEP);
+        for (; rehashIndex_ < limit; ++rehashIndex_) {
+            std::atomic<Node*>& oldHead = old->heads[rehashIndex_];
+            Node* node = oldHead.load(std::memory_order_relaxed);
+            while (node) {
+                Node* next = node->next.load(std::memory_order_relaxed);
+                oldHead.store(next, std::memory_order_relaxed);
+                std::atomic<Node*>& newHead = cur->heads[bucket_index(Traits::hash(node, hash_), cur->capacity())];
+                node->next.store(newHead.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                newHead.store(node, std::memory_order_release);
+                node = next;
+            }
+        }
+
+        if (rehashIndex_ == old->capacity()) {
+            oldBuckets_.store(nullptr, std::memory_order_release);
+            rehashIndex_ = 0;
+            bucketBytes_.fetch_sub(old->capacity() * sizeof(std::atomic<Node*>), std::memory_order_relaxed);
+            retired_.retire(
+                old, [](void*, void* ptr) { delete static_cast<Buckets*>(ptr); }, nullptr);
+        }
+        end_migration();
+    }
 };
 
 }  // namespace kv
@@ -0,0 +1,106 @@
+// файл: include/kv/hash_utils.hpp
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace kv {
+
+// Финализатор (splitmix64): перемешивает биты пользовательского хеша так,
+// чтобы и младшие, и старшие биты зависели от всех битов входа.
+// Нужен, потому что ShardedHashMap уже "съедает" младшие биты на выбор шарда.
+inline std::uint64_t mix_hash(std::uint64_t h) noexcept {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// Подсказка процессору заранее подтянуть кэш-линию (для чтения).
+inline void prefetch(const void* ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+    (void)ptr;
+#endif
+}
+
+// Биты числа в обратном порядке (для курсора SCAN).
+inline std::uint64_t reverse_bits(std::uint64_t v) noexcept {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return std::byteswap(v);
+}
+
+// Ближайшая степень двойки, не меньшая n (минимум 1).
+inline std::size_t round_up_pow2(std::size_t n) noexcept {
+    std::size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Следующий курсор обхода корзин в обратном двоичном порядке (как SCAN в Redis): инкремент
+// идёт со старшего значащего бита маски, поэтому после удвоения или уменьшения массива
+// уже пройденные корзины остаются пройденными.
+inline std::uint64_t scan_cursor_next(std::uint64_t cursor, std::uint64_t mask) noexcept {
+    cursor |= ~mask;
+    cursor = reverse_bits(cursor);
+    ++cursor;
+    return reverse_bits(cursor);
+}
+
+// Прозрачные хеш и сравнение для строковых ключей: позволяют искать по std::string_view
+// (например, прямо в буфере приёма) без создания временной std::string.
+// std::hash<std::string> и std::hash<std::string_view> по стандарту дают одинаковый результат.
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+struct StringEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const noexcept { return a == b; }
+};
+
+// Hash/KeyEqual по умолчанию для таблиц: для std::string — прозрачные варианты.
+template <typename Key>
+struct DefaultHashTraits {
+    using hash = std::hash<Key>;
+    using key_equal = std::equal_to<Key>;
+};
+
+template <>
+struct DefaultHashTraits<std::string> {
+    using hash = StringHash;
+    using key_equal = StringEqual;
+};
+
+template <typename Key>
+using DefaultHash = typename DefaultHashTraits<Key>::hash;
+
+template <typename Key>
+using DefaultKeyEqual = typename DefaultHashTraits<Key>::key_equal;
+
+// Поддерживают ли Hash и KeyEqual поиск по ключу другого типа (is_transparent).
+template <typename Hash, typename KeyEqual>
+concept TransparentLookup = requires {
+    typename Hash::is_transparent;
+    typename KeyEqual::is_transparent;
+};
+
+}  // namespace kv
@@ -0,0 +1,110 @@
+// файл: include/kv/io_uring.hpp
+#pragma once
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kv {
+
+/*
+    Минимальная обёртка над io_uring на системных вызовах, без liburing: кольца отправки (SQ)
+    и завершения (CQ), отображённые в память процесса, и кольцо буферов для recv.
+
+    Кольцом владеет один поток (IORING_SETUP_SINGLE_ISSUER): get_sqe() только заполняет
+    очередной SQE в общей памяти, а в ядро всё накопленное уходит одним io_uring_enter в
+    submit_and_wait() — один системный вызов на проход цикла событий вместо вызова на каждую
+    операцию. Там же поток ждёт завершений, а drain() разбирает их без системных вызовов.
+
+    Кольцо буферов (IORING_REGISTER_PBUF_RING): recv с IOSQE_BUFFER_SELECT не держит буфер,
+    пока ждёт данных, — ядро берёт свободный буфер из кольца в момент прихода данных, а
+    владелец возвращает его через recycle().
+*/
+class IoUring {
+   public:
+    static constexpr std::uint16_t kBufferGroup = 0;
+
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // false — io_uring недоступен (старое ядро, запрет seccomp) или без нужных возможностей.
+    bool init(unsigned entries);
+
+    // Свободный обнулённый SQE; если очередь полна, накопленное сначала отправляется в ядро.
+    // nullptr — ядро не принимает новые операции.
+    io_uring_sqe* get_sqe();
+
+    // Отправляет накопленные SQE без ожидания.
+    void submit();
+
+    // Отправляет накопленные SQE и ждёт хотя бы одного завершения не дольше timeoutMs
+    // (-1 — без ограничения, 0 — только забрать готовые).
+    void submit_and_wait(int timeoutMs);
+
+    // Обходит готовые CQE; слот кольца освобождается до вызова fn, так что fn может ставить
+    // новые операции.
+    template <typename Fn>
+    void drain(Fn&& fn) {
+        unsigned head = *cqHead_;
+        while (head != std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire)) {
+            io_uring_cqe cqe = cqes_[head & cqMask_];
+            ++head;
+            std::atomic_ref<unsigned>(*cqHead_).store(head, std::memory_order_release);
+            fn(cqe);
+        }
+    }
+
+    // Кольцо из count (степень двойки) буферов по size байт; false — ядро его не поддерживает.
+    bool setup_buffers(unsigned count, size_t size);
+    bool has_buffers() const { return bufRing_ != nullptr; }
+    size_t buffer_size() const { return bufferSize_; }
+    const char* buffer(unsigned id) const { return buffers_ + id * bufferSize_; }
+    void recycle(unsigned id);
+
+    // Сколько раз вызывался io_uring_enter.
+    std::uint64_t enters() const { return enters_; }
+
+   private:
+    int fd_ = -1;
+
+    void* ring_ = nullptr;
+    size_t ringBytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesBytes_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned sqLocalTail_ = 0;  // заполненные SQE; ядру публикуются в submit
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cqMask_ = 0;
+
+    io_uring_buf_ring* bufRing_ = nullptr;
+    size_t bufRingBytes_ = 0;
+    char* buffers_ = nullptr;
+    size_t buffersBytes_ = 0;
+    size_t bufferSize_ = 0;
+    unsigned bufMask_ = 0;
+    std::uint16_t bufTail_ = 0;
+
+    std::uint64_t enters_ = 0;
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize);
+    void add_buffer(unsigned id);
+};
+
+}  // namespace kv
+
+#endif  // __linux__
@@ -0,0 +1,56 @@
+// файл: include/kv/lz.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace kv::lz {
+
+/*
+    Быстрый кодек семейства LZ77 для больших значений (формат блока LZ4, без внешней библиотеки).
+
+    Поток — последовательность команд: токен (старшие 4 бита — длина литералов, младшие — длина
+    совпадения минус 4; значение 15 продолжается байтами по 255), литералы, смещение совпадения
+    (2 байта, little-endian, не больше 65535) и хвост длины совпадения. Последняя команда —
+    только литералы. Совпадения ищутся по хеш-таблице 4-байтовых префиксов без цепочек,
+    поэтому сжатие однопроходное и не выделяет памяти.
+*/
+
+// Верхняя граница размера сжатых данных для n байт входа.
+constexpr size_t max_compressed_size(size_t n) { return n + n / 255 + 16; }
+
+// Сжимает src[0, n) в dst. Возвращает размер сжатых данных; 0 — результат не поместился в capacity.
+size_t compress(const char* src, size_t n, char* dst, size_t capacity);
+
+// Распаковывает src[0, n) ровно в rawSize байт dst. false — данные повреждены.
+bool decompress(const char* src, size_t n, char* dst, size_t rawSize);
+
+// Сжатое значение в узле хранилища: [u32 исходная длина][поток LZ].
+inline constexpr size_t kPackedHeader = sizeof(std::uint32_t);
+
+// Сжимает value в out (вместе с заголовком). false — сжатие не уменьшило значение, out не заполнен.
+bool pack(std::string_view value, std::string& out);
+
+// Исходная длина сжатого значения.
+size_t unpacked_size(std::string_view packed);
+
+// Поток LZ сжатого значения (без заголовка).
+inline std::string_view packed_data(std::string_view packed) { return packed.substr(kPackedHeader); }
+
+// Распаковывает сжатое значение в out. false — данные повреждены.
+bool unpack(std::string_view packed, std::string& out);
+
+// Накопленная статистика pack/unpack (для INFO).
+struct Stats {
+    std::uint64_t rawBytes;         // исходный размер значений, которые удалось сжать
+    std::uint64_t compressedBytes;  // их размер после сжатия (с заголовком)
+    std::uint64_t skipped;          // попытки, не давшие выигрыша (значение хранится как есть)
+    std::uint64_t compressNs;       // время сжатия
+    std::uint64_t decompressNs;     // время распаковки
+};
+
+Stats stats();
+
+}  // namespace kv::lz
@@ -0,0 +1,49 @@
+// файл: include/kv/request_buffer.hpp
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "config.hpp"
+
+namespace kv {
+
+/*
+    Буфер приёма соединения для строчного протокола. Чтение из сокета не совпадает с границами
+    команд: в одном пакете может прийти несколько команд (pipelining), а длинный SET — растянуться
+    на несколько сегментов TCP. Байты копятся в буфере, next_line() отдаёт по одной полные
+    строки (до '\n', без "\r\n"), а незаконченный хвост ждёт следующего чтения.
+
+    Строки, выданные next_line(), ссылаются прямо в буфер и живы до следующего prepare():
+    сервер разбирает и выполняет команду, не копируя ключ и значение. prepare() сдвигает хвост
+    в начало и при необходимости растит буфер, но не дальше MAX_REQUEST_SIZE — строку длиннее
+    клиент, видимо, шлёт без '\n', и overflow() об этом сообщает.
+*/
+class RequestBuffer {
+   public:
+    RequestBuffer() : data_(kv::config::CONNECTION_BUFFER_SIZE) {}
+
+    // Следующая полная строка; nullopt — в буфере только начало строки (или ничего).
+    std::optional<std::string_view> next_line();
+
+    // Место под следующее чтение: не меньше половины CONNECTION_BUFFER_SIZE, если буфер не упёрся
+    // в предел. Вызывать, когда next_line() вернул nullopt.
+    std::span<char> prepare();
+
+    // После чтения n байт в область prepare().
+    void commit(size_t n) { end_ += n; }
+
+    // Незаконченная строка длиннее MAX_REQUEST_SIZE.
+    bool overflow() const { return end_ - begin_ > kv::config::MAX_REQUEST_SIZE; }
+
+   private:
+    std::vector<char> data_;
+    size_t begin_ = 0;    // начало первой невыданной строки
+    size_t scanned_ = 0;  // до этой позиции '\n' уже искали — длинный хвост не просматривается заново
+    size_t end_ = 0;      // конец принятых байт
+};
+
+}  // namespace kv
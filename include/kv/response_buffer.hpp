@@ -0,0 +1,59 @@
+// файл: include/kv/response_buffer.hpp
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config.hpp"
+#include "kv/coroutine_io.hpp"
+
+namespace kv {
+
+/*
+    Буфер ответов соединения. Ответы на все команды одной пачки (всё, что разобрано из одного
+    чтения) копятся здесь и уходят в сокет одной векторной записью — вместо системного вызова
+    и оборота цикла событий на каждый ответ.
+
+    Короткие ответы копируются во внутренний буфер, соседние копии склеиваются в один фрагмент.
+    append_ref() не копирует байты, а ссылается на них: так крупные значения уходят прямо из
+    буфера значения хранилища, и вызывающий держит их (ValueHandle) до полного сброса буфера.
+    Частичная запись (сокет заполнен) не теряет данных: consume() снимает только записанное,
+    остальное ждёт следующего writev.
+*/
+class ResponseBuffer {
+   public:
+    void append(std::string_view bytes);
+
+    // Байты должны жить, пока буфер не опустеет.
+    void append_ref(std::string_view bytes);
+
+    bool empty() const { return pending_ == 0; }
+
+    // Сколько байт ждёт отправки.
+    size_t size() const { return pending_; }
+
+    // Неотправленные байты фрагментами для async_writev; действительны до следующего append/consume.
+    std::span<const IoSlice> slices();
+
+    // После записи n байт из slices().
+    void consume(size_t n);
+
+   private:
+    // data == nullptr — байты лежат в bytes_ с позиции offset (bytes_ может переехать при росте).
+    struct Piece {
+        const char* data;
+        size_t offset;
+        size_t size;
+    };
+
+    std::string bytes_;
+    std::vector<Piece> pieces_;
+    size_t head_ = 0;     // первый неотправленный фрагмент
+    size_t pending_ = 0;  // неотправленные байты
+    std::vector<IoSlice> iov_;
+};
+
+}  // namespace kv
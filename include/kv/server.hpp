@@ -1,14 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <initializer_list>
 #include <iostream>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "config.hpp"
+#include "kv/core_mesh.hpp"
 #include "kv/coroutine_io.hpp"
 #include "kv/logger.hpp"
+#include "kv/lz.hpp"
+#include "kv/request_buffer.hpp"
+#include "kv/response_buffer.hpp"
 #include "kv/sharded_hash_map.hpp"
 
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
 namespace kv {
 
 #ifdef _WIN32
@@ -25,6 +46,18 @@ using SOCKET_TYPE = SOCKET;
 using SOCKET_TYPE = int;
 #endif
 
+// Фиксированные ответы протокола.
+namespace reply {
+inline constexpr std::string_view STORED = "STORED\n";
+inline constexpr std::string_view DELETED = "DELETED\n";
+inline constexpr std::string_view NOT_FOUND = "NOT_FOUND\n";
+inline constexpr std::string_view ERROR = "ERROR\n";
+inline constexpr std::string_view ERROR_TOO_LARGE = "ERROR_TOO_LARGE\n";
+inline constexpr std::string_view OK = "OK\n";
+inline constexpr std::string_view EXISTS = "EXISTS\n";
+inline constexpr std::string_view ERROR_NOT_INTEGER = "ERROR_NOT_INTEGER\n";
+}  // namespace reply
+
 struct Task {
     struct promise_type {
         Task get_return_object() noexcept { return {}; }
@@ -36,8 +69,8 @@ struct Task {
 };
 
 template <typename Key, typename Value,
-          typename Hash = std::hash<Key>,
-          typename KeyEqual = std::equal_to<Key>>
+          typename Hash = DefaultHash<Key>,
+          typename KeyEqual = DefaultKeyEqual<Key>>
 class Server {
    public:
     Server(const std::string& address, uint16_t port);
@@ -45,41 +78,521 @@ class Server {
 
     void run();
 
+    // Бюджет памяти хранилища (0 — без ограничения) и политика вытеснения; вызывать до run().
+    void set_max_memory(size_t bytes, kv::config::EvictionPolicy policy);
+
+    // Число потоков-ядер (режим ядро-на-поток при cores > 1); вызывать до run().
+    void set_core_threads(size_t cores);
+
+    // Число потоков ввода-вывода в режиме без ядер (шарды общие, под блокировками); вызывать до run().
+    void set_io_threads(size_t threads);
+
+    // Доля процессорного времени каждого ядра на активную дефрагментацию, в процентах
+    // (0 — выключена); вызывать до run().
+    void set_defrag_cpu_percent(size_t percent);
+
    private:
     std::string address_;
     uint16_t port_;
-    SOCKET_TYPE listenFd_;
+    std::vector<SOCKET_TYPE> listeners_;
+
+    // Слушающие сокеты для loops циклов событий: на Linux у каждого цикла свой (SO_REUSEPORT —
+    // ядро ОС само распределяет входящие соединения), на Windows один общий.
+    void setup_listening_sockets(size_t loops);
+    SOCKET_TYPE open_listening_socket(bool reusePort);
+
+    // Приём соединений в цикле событий текущего потока: соединение обслуживает тот же цикл.
+    Task accept_connections(SOCKET_TYPE listenFd);
 
-    void setup_listening_socket();
+    // Режим ядро-на-поток: поток и EventLoop на каждое ядро, каждое принимает соединения само.
+    void run_cores();
 
-    void accept_loop();
+    // Режим без ядер: ioThreads_ потоков со своими EventLoop принимают и обслуживают соединения
+    // над общими шардами.
+    void run_io_threads();
+
+    // Таймер POOL_TRIM_MS: возвращает системе пустые арены SlabAllocator и пулов узлов шардов.
+    void trim_memory();
+
+    // Таймер DEFRAG_TICK_MS: шаг дефрагментации шардов ядра в пределах defragCpuPercent_.
+    // Осушение арен SlabAllocator общее для процесса, поэтому заканчивает проход последнее ядро:
+    // ядро, прошедшее свои шарды, ждёт остальных и нового прохода не начинает.
+    void defrag_cycle(ShardOwner owner);
 
     Task handle_connection(SOCKET_TYPE clientFd);
 
-    ShardedHashMap<Key, Value, Hash, KeyEqual> shardedMap_;
+    // Ядро-владелец шарда: шард s принадлежит ядру s % cores (0 — в режиме с одним циклом).
+    size_t owner_core(size_t shard) const { return mesh_ ? shard % mesh_->cores() : 0; }
+
+    ShardOwner owner_of(size_t core) const { return mesh_ ? ShardOwner{core, mesh_->cores()} : ShardOwner{}; }
+
+    // co_await on_key_owner(key, fn): fn выполняется на ядре, владеющем шардом ключа, и корутина
+    // продолжается на своём ядре с результатом fn. В режиме с одним циклом — сразу, без хеширования.
+    template <typename Fn>
+    auto on_key_owner(std::string_view key, Fn fn) {
+        size_t core = mesh_ ? owner_core(shardedMap_.shard_of(lookup_key(key))) : 0;
+        return run_on_core(mesh_.get(), core, std::move(fn));
+    }
+
+    // Ядра, которым принадлежат ключи пакета (по возрастанию).
+    template <typename K>
+    std::vector<size_t> cores_of(const std::vector<K>& keys) const {
+        if (!mesh_) {
+            return {0};
+        }
+        std::vector<bool> used(mesh_->cores(), false);
+        for (const K& key : keys) {
+            used[owner_core(shardedMap_.shard_of(key))] = true;
+        }
+        std::vector<size_t> cores;
+        for (size_t core = 0; core < used.size(); ++core) {
+            if (used[core]) {
+                cores.push_back(core);
+            }
+        }
+        return cores;
+    }
+
+    // Ключ для поиска: при прозрачных Hash/KeyEqual — string_view прямо в буфер приёма,
+    // иначе приходится строить Key.
+    static auto lookup_key(std::string_view key) {
+        if constexpr (TransparentLookup<Hash, KeyEqual>) {
+            return key;
+        } else {
+            return Key(key);
+        }
+    }
+
+    // Положительное целое число (секунды SETEX/EXPIRE, COUNT в SCAN).
+    static bool parse_positive(std::string_view text, std::uint64_t& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size() && value > 0;
+    }
+
+    // Целое со знаком (INCRBY, значение под INCR), строка целиком.
+    static bool parse_integer(std::string_view text, std::int64_t& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size() && !text.empty();
+    }
+
+    // Десятичная запись value и '\n' в out (не меньше 24 байт); возвращает длину.
+    static size_t format_integer(char* out, std::int64_t value) {
+        char* end = std::to_chars(out, out + 23, value).ptr;
+        *end++ = '\n';
+        return static_cast<size_t>(end - out);
+    }
+
+    // Отделяет от значения SET хвост " EX <секунды>" (0 — без срока жизни). Срок — только строгий
+    // последний токен из одних цифр; значение, которое само так оканчивается, сохраняют с
+    // дополнительным " EX 0" на конце или командой SETEX.
+    static std::uint64_t split_ttl(std::string_view& val) {
+        size_t pos = val.rfind(" EX ");
+        if (pos == std::string_view::npos) {
+            return 0;
+        }
+        std::string_view digits = val.substr(pos + 4);
+        std::uint64_t seconds = 0;
+        auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), seconds);
+        if (digits.empty() || ec != std::errc() || end != digits.data() + digits.size()) {
+            return 0;
+        }
+        val = val.substr(0, pos);
+        return seconds;
+    }
+
+    // Заголовок значения для клиента с COMPRESS ON: prefix и числа через пробел, затем '\n'
+    // (out — не меньше 48 байт). Возвращает конец записанного.
+    static char* format_header(char* out, std::string_view prefix, std::initializer_list<size_t> sizes) {
+        out = std::copy(prefix.begin(), prefix.end(), out);
+        for (size_t size : sizes) {
+            out = std::to_chars(out, out + 20, size).ptr;
+            *out++ = ' ';
+        }
+        out[-1] = '\n';
+        return out;
+    }
+
+    // Отношение для INFO: два знака после точки.
+    static std::string format_ratio(double value) {
+        char out[32];
+        char* end = std::to_chars(out, out + sizeof(out), value, std::chars_format::fixed, 2).ptr;
+        return std::string(out, end);
+    }
+
+    // Аргументы пакетной команды (MGET/MSET/MDEL), разделённые пробелами.
+    static std::vector<std::string_view> split_args(std::string_view args) {
+        std::vector<std::string_view> tokens;
+        while (true) {
+            size_t start = args.find_first_not_of(' ');
+            if (start == std::string_view::npos) {
+                return tokens;
+            }
+            args.remove_prefix(start);
+            size_t end = std::min(args.find(' '), args.size());
+            tokens.push_back(args.substr(0, end));
+            args.remove_prefix(end);
+        }
+    }
+
+    // Значение в ответ: крупное — ссылкой в его буфер (handle держится в pinned до сброса output),
+    // короткое — копией. value — байты внутри буфера handle.
+    template <typename Handle>
+    static void append_value(ResponseBuffer& output, std::vector<Handle>& pinned, Handle handle,
+                             std::string_view value) {
+        if (value.size() >= kv::config::RESPONSE_REF_MIN_SIZE) {
+            output.append_ref(value);
+            pinned.push_back(std::move(handle));
+        } else {
+            output.append(value);
+        }
+    }
+
+    // Ключи пакета в виде, пригодном для поиска (см. lookup_key).
+    template <typename T = Key>
+    static auto batch_of(std::vector<std::string_view> tokens) {
+        if constexpr (TransparentLookup<Hash, KeyEqual>) {
+            return tokens;
+        } else {
+            return std::vector<T>(tokens.begin(), tokens.end());
+        }
+    }
+
+    // INCR/DECR/INCRBY: прибавляет delta к числу под ключом (нет ключа — считается 0).
+    // nullopt — значение не целое или сумма не помещается в int64.
+    std::optional<std::int64_t> increment(std::string_view key, std::int64_t delta);
+
+    // APPEND: дописывает suffix к значению (нет ключа — создаёт). Новая длина или nullopt,
+    // если значение превысило бы MAX_VALUE_SIZE.
+    std::optional<size_t> append(std::string_view key, std::string_view suffix);
+
+    // CAS key expected new: STORED — значение было expected и заменено, EXISTS — значение другое,
+    // NOT_FOUND — ключа нет.
+    std::string_view compare_and_set(std::string_view key, std::string_view expected, std::string_view desired);
+
+    // Ответ на INFO [section]: строки "имя:значение", завершённые строкой END. Без секции —
+    // вся статистика, "memory" — только память. Пустая строка — неизвестная секция.
+    std::string info(std::string_view section = {}) const;
+
+    // SCAN cursor [MATCH prefix] [COUNT n]: следующий курсор, затем ключи по строке, затем END.
+    // Пустая строка — ошибка синтаксиса.
+    std::string scan(std::string_view args);
+
+    using Map = ShardedHashMap<Key, Value, Hash, KeyEqual>;
+
+    // Закреплённое значение ключа (ValueHandle или PackedValueHandle).
+    using ValueRef = decltype(std::declval<const Map&>().get_ref(lookup_key({})));
+
+    static constexpr bool kCanScan =
+        std::is_convertible_v<Key, std::string_view> &&
+        requires(Map& map) { map.scan(std::uint64_t{}, size_t{}, [](std::string_view) {}); };
+
+    Map shardedMap_;
+    size_t maxMemory_ = kv::config::MAX_MEMORY_BYTES;
+
+    size_t defragCpuPercent_ = kv::config::DEFRAG_CPU_PERCENT;
+    std::atomic<std::uint64_t> defragCpuUs_{0};  // время всех ядер на дефрагментацию
+    std::atomic<std::uint64_t> defragPass_{0};      // номер текущего прохода дефрагментации
+    std::atomic<size_t> defragFinished_{0};         // ядра, закончившие текущий проход
+    std::vector<std::uint64_t> defragCorePass_;     // по ядру: последний законченный им проход + 1
+
+    size_t coreThreads_ = kv::config::CORE_THREADS;
+    std::unique_ptr<CoreMesh> mesh_;  // nullptr — режим без ядер: шарды общие
+
+    size_t ioThreads_ = kv::config::IO_THREADS;
+
+    std::atomic<size_t> connections_{0};          // открытые соединения всех циклов
+    std::atomic<size_t> rejectedConnections_{0};  // закрыты сразу: превышен MAX_CONNECTIONS
 };
 
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
 Server<Key, Value, Hash, KeyEqual>::Server(const std::string& address, uint16_t port)
     : address_(address),
       port_(port),
-      listenFd_(-1),
       shardedMap_(kv::config::HASH_MAP_SHARDS) {}
 
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
 Server<Key, Value, Hash, KeyEqual>::~Server() {
-    if (listenFd_ != -1) {
+    for (SOCKET_TYPE listenFd : listeners_) {
 #ifdef _WIN32
-        closesocket(listenFd_);
+        closesocket(listenFd);
 #else
-        close(listenFd_);
+        close(listenFd);
 #endif
     }
 }
 
-// Настройка слушающего сокета
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
-void Server<Key, Value, Hash, KeyEqual>::setup_listening_socket() {
+void Server<Key, Value, Hash, KeyEqual>::set_max_memory(size_t bytes, kv::config::EvictionPolicy policy) {
+    if constexpr (Map::kSupportsEviction) {
+        shardedMap_.set_max_memory(bytes, policy);
+        maxMemory_ = bytes;
+    } else {
+        LOG_WARN("maxmemory is not supported by this table type");
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::trim_memory() {
+    size_t released = SlabAllocator::instance().trim();
+    if constexpr (Map::kSupportsEviction) {
+        released += shardedMap_.trim_memory();
+    }
+    if (released != 0) {
+        LOG_DEBUG("Returned " + std::to_string(released) + " bytes of empty arenas to the OS");
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::defrag_cycle(ShardOwner owner) {
+    if constexpr (Map::kSupportsDefrag) {
+        std::uint64_t pass = defragPass_.load(std::memory_order_acquire);
+        if (defragCorePass_[owner.core] == pass + 1) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto budget = std::chrono::microseconds(kv::config::DEFRAG_TICK_MS * 1000 * defragCpuPercent_ / 100);
+        if (shardedMap_.defrag_cycle(budget, owner)) {
+            // Свои шарды пройдены: магазин ядра возвращает ячейки (среди них могут быть последние
+            // ячейки осушаемых арен). Последнее ядро возвращает в работу осушаемые арены
+            // SlabAllocator, которые не опустели, и открывает следующий проход.
+            defragCorePass_[owner.core] = pass + 1;
+            SlabAllocator::instance().flush_magazines();
+            if (defragFinished_.fetch_add(1, std::memory_order_acq_rel) + 1 == owner.cores) {
+                defragFinished_.store(0, std::memory_order_relaxed);
+                SlabAllocator::instance().end_defrag();
+                defragPass_.fetch_add(1, std::memory_order_release);
+            }
+        }
+        auto spent = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        defragCpuUs_.fetch_add(static_cast<std::uint64_t>(spent.count()), std::memory_order_relaxed);
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::set_core_threads(size_t cores) {
+    coreThreads_ = std::max<size_t>(cores, 1);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::set_io_threads(size_t threads) {
+    ioThreads_ = std::max<size_t>(threads, 1);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::set_defrag_cpu_percent(size_t percent) {
+    defragCpuPercent_ = std::min<size_t>(percent, 100);
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::string Server<Key, Value, Hash, KeyEqual>::info(std::string_view section) const {
+    bool all = section.empty();
+    if (!all && section != "memory") {
+        return {};
+    }
+    std::string out;
+    if (all) {
+        out += "keys:" + std::to_string(shardedMap_.size()) + "\n";
+        out += "shards:" + std::to_string(shardedMap_.shard_count()) + "\n";
+        out += "resharding:" + std::string(shardedMap_.resharding() ? "1" : "0") + "\n";
+        out += "connected_clients:" + std::to_string(connections_.load(std::memory_order_relaxed)) + "\n";
+        out += "rejected_connections:" + std::to_string(rejectedConnections_.load(std::memory_order_relaxed)) + "\n";
+        out += std::string("io_backend:") +
+               (EventLoop::instance().backend() == IoBackend::IoUring ? "io_uring" : "epoll") + "\n";
+    }
+    if constexpr (Map::kSupportsEviction) {
+        // Память: счётчики шардов, которые поддерживаются при записи, — запрос не обходит ключи.
+        MemoryStats mem = shardedMap_.memory_stats();
+        out += "used_memory:" + std::to_string(shardedMap_.memory_usage()) + "\n";
+        out += "used_memory_nodes:" + std::to_string(mem.nodes) + "\n";
+        out += "used_memory_payload:" + std::to_string(mem.payload) + "\n";
+        out += "used_memory_buckets:" + std::to_string(mem.buckets) + "\n";
+        out += "used_memory_pool_slack:" + std::to_string(mem.poolSlack) + "\n";
+        out += "used_memory_total:" + std::to_string(mem.total()) + "\n";
+        out += "maxmemory:" + std::to_string(maxMemory_) + "\n";
+        out += "shard_memory:";
+        for (size_t s = 0, count = shardedMap_.shard_count(); s < count; ++s) {
+            out += (s ? "," : "") + std::to_string(shardedMap_.shard_memory_usage(s));
+        }
+        out += "\n";
+        // Классы SlabAllocator: выданные ячейки, запрошенные байты (остальное — округление до класса),
+        // взятая у системы память и её свободная часть; fragmentation — взято / запрошено.
+        size_t slabRequested = 0;
+        size_t slabReserved = 0;
+        for (const SlabAllocator::ClassStats& cls : SlabAllocator::instance().stats()) {
+            slabRequested += cls.requestedBytes;
+            slabReserved += cls.reservedBytes;
+            if (cls.cellSize == 0) {
+                out += "slab_large:count=" + std::to_string(cls.cells) + ",bytes=" + std::to_string(cls.reservedBytes) +
+                       "\n";
+                continue;
+            }
+            out += "slab_" + std::to_string(cls.cellSize) + ":cells=" + std::to_string(cls.cells) +
+                   ",requested=" + std::to_string(cls.requestedBytes) + ",reserved=" + std::to_string(cls.reservedBytes) +
+                   ",free=" + std::to_string(cls.freeBytes) + "\n";
+        }
+        double fragmentation = slabRequested ? static_cast<double>(slabReserved) / slabRequested : 1.0;
+        out += "slab_fragmentation:" + format_ratio(fragmentation) + "\n";
+        if constexpr (Map::kSupportsDefrag) {
+            // Дефрагментация: перенесённые узлы и память арен, которые после переноса опустели.
+            DefragStats defrag = SlabAllocator::instance().defrag_stats();
+            defrag += shardedMap_.defrag_stats();
+            out += "defrag_moved_nodes:" + std::to_string(defrag.movedCells) + "\n";
+            out += "defrag_moved_bytes:" + std::to_string(defrag.movedBytes) + "\n";
+            out += "defrag_reclaimed_bytes:" + std::to_string(defrag.reclaimedBytes) + "\n";
+            out += "defrag_cpu_us:" + std::to_string(defragCpuUs_.load(std::memory_order_relaxed)) + "\n";
+        }
+        if (all) {
+            out += "evicted_keys:" + std::to_string(shardedMap_.evictions()) + "\n";
+        }
+    }
+    if constexpr (Map::kSupportsCompression) {
+        if (all) {
+            // Сжатие: во сколько раз уменьшились сжатые значения и время кодека.
+            lz::Stats lzStats = lz::stats();
+            double ratio = lzStats.compressedBytes ? static_cast<double>(lzStats.rawBytes) / lzStats.compressedBytes : 1.0;
+            out += "compression_ratio:" + format_ratio(ratio) + "\n";
+            out += "compression_saved_bytes:" + std::to_string(lzStats.rawBytes - lzStats.compressedBytes) + "\n";
+            out += "compression_skipped:" + std::to_string(lzStats.skipped) + "\n";
+            out += "compress_cpu_us:" + std::to_string(lzStats.compressNs / 1000) + "\n";
+            out += "decompress_cpu_us:" + std::to_string(lzStats.decompressNs / 1000) + "\n";
+        }
+    }
+    out += "END\n";
+    return out;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::string Server<Key, Value, Hash, KeyEqual>::scan(std::string_view args) {
+    auto next_token = [&args]() {
+        size_t start = args.find_first_not_of(' ');
+        if (start == std::string_view::npos) {
+            args = {};
+            return std::string_view{};
+        }
+        args.remove_prefix(start);
+        size_t end = std::min(args.find(' '), args.size());
+        std::string_view token = args.substr(0, end);
+        args.remove_prefix(end);
+        return token;
+    };
+
+    std::uint64_t cursor = 0;
+    std::string_view token = next_token();
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), cursor);
+    if (ec != std::errc() || end != token.data() + token.size()) {
+        return {};
+    }
+
+    std::string_view prefix;
+    std::uint64_t count = kv::config::SCAN_DEFAULT_COUNT;
+    for (token = next_token(); !token.empty(); token = next_token()) {
+        std::string_view arg = next_token();
+        if (token == "MATCH" && !arg.empty()) {
+            // Поддерживается только префикс: "user:" или "user:*".
+            prefix = arg.ends_with('*') ? arg.substr(0, arg.size() - 1) : arg;
+        } else if (token == "COUNT" && parse_positive(arg, count)) {
+            count = std::min<std::uint64_t>(count, kv::config::SCAN_MAX_COUNT);
+        } else {
+            return {};
+        }
+    }
+
+    std::string keys;
+    ShardOwner owner = owner_of(owner_core(shardedMap_.scan_shard(cursor)));
+    cursor = shardedMap_.scan(
+        cursor, static_cast<size_t>(count),
+        [&](std::string_view key) {
+            if (key.starts_with(prefix)) {
+                keys.append(key);
+                keys.push_back('\n');
+            }
+        },
+        owner);
+    return std::to_string(cursor) + "\n" + keys + "END\n";
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::optional<std::int64_t> Server<Key, Value, Hash, KeyEqual>::increment(std::string_view key, std::int64_t delta) {
+    std::optional<std::int64_t> result;
+    shardedMap_.update(lookup_key(key),
+                       [&](const auto* current, std::optional<std::int64_t> integer) -> std::optional<std::int64_t> {
+                           // Счётчик, уже записанный INCR, хранится числом — разбирать текст не нужно.
+                           std::int64_t value = 0;
+                           if (integer) {
+                               value = *integer;
+                           } else if (current && !parse_integer(std::string_view(*current), value)) {
+                               return std::nullopt;
+                           }
+                           constexpr auto kMax = std::numeric_limits<std::int64_t>::max();
+                           constexpr auto kMin = std::numeric_limits<std::int64_t>::min();
+                           if ((delta > 0 && value > kMax - delta) || (delta < 0 && value < kMin - delta)) {
+                               return std::nullopt;
+                           }
+                           result = value + delta;
+                           return result;
+                       });
+    return result;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::optional<size_t> Server<Key, Value, Hash, KeyEqual>::append(std::string_view key, std::string_view suffix) {
+    std::optional<size_t> length;
+    shardedMap_.update(lookup_key(key), [&](const auto* current, std::optional<std::int64_t>) -> std::optional<std::string> {
+        std::string_view base = current ? std::string_view(*current) : std::string_view{};
+        if (base.size() + suffix.size() > kv::config::MAX_VALUE_SIZE) {
+            return std::nullopt;
+        }
+        std::string value;
+        value.reserve(base.size() + suffix.size());
+        value.append(base).append(suffix);
+        length = value.size();
+        return value;
+    });
+    return length;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+std::string_view Server<Key, Value, Hash, KeyEqual>::compare_and_set(std::string_view key, std::string_view expected,
+                                                                     std::string_view desired) {
+    std::string_view resp = reply::NOT_FOUND;
+    shardedMap_.update(lookup_key(key), [&](const auto* current, std::optional<std::int64_t>) -> std::optional<std::string_view> {
+        if (!current) {
+            return std::nullopt;
+        }
+        if (std::string_view(*current) != expected) {
+            resp = reply::EXISTS;
+            return std::nullopt;
+        }
+        resp = reply::STORED;
+        return desired;
+    });
+    return resp;
+}
+
+// Настройка слушающих сокетов
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::setup_listening_sockets(size_t loops) {
+#ifdef _WIN32
+    // SO_REUSEPORT нет: все циклы ждут один сокет, соединение достаётся тому, кто успел accept.
+    listeners_.push_back(open_listening_socket(false));
+#else
+    for (size_t loop = 0; loop < loops; ++loop) {
+        listeners_.push_back(open_listening_socket(loops > 1));
+    }
+#endif
+
+    if constexpr (kv::config::ENABLE_DEBUG_LOG) {
+        LOG_INFO("The server is listening on " + address_ + ":" + std::to_string(port_));
+        LOG_INFO("  -> Thread pool size: " + std::to_string(kv::config::THREAD_POOL_SIZE));
+        LOG_INFO("  -> Shards in HashMap: " + std::to_string(kv::config::HASH_MAP_SHARDS));
+        LOG_INFO("  -> Max connections: " + std::to_string(kv::config::MAX_CONNECTIONS));
+        LOG_INFO("  -> Listening sockets: " + std::to_string(listeners_.size()));
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+SOCKET_TYPE Server<Key, Value, Hash, KeyEqual>::open_listening_socket([[maybe_unused]] bool reusePort) {
+    SOCKET_TYPE listenFd;
 #ifdef _WIN32
     WSADATA wsaData;
     int startupRes = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -88,13 +601,13 @@ void Server<Key, Value, Hash, KeyEqual>::setup_listening_socket() {
     }
 
     // Создаём сокет
-    listenFd_ = WSASocket(AF_INET, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_OVERLAPPED);
-    if (listenFd_ == INVALID_SOCKET) {
+    listenFd = WSASocket(AF_INET, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_OVERLAPPED);
+    if (listenFd == INVALID_SOCKET) {
         LOG_FATAL(std::string("WSASocket failed: ") + std::to_string(WSAGetLastError()));
     }
     // Разрешаем переиспользование адреса
     int opt = 1;
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
 
     // Привязываем к адресу
     sockaddr_in addr{};
@@ -102,180 +615,587 @@ void Server<Key, Value, Hash, KeyEqual>::setup_listening_socket() {
     inet_pton(AF_INET, address_.c_str(), &addr.sin_addr);
     addr.sin_port = htons(port_);
 
-    if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
         LOG_FATAL(std::string("bind failed: ") + std::to_string(WSAGetLastError()));
     }
 
-    if (listen(listenFd_, static_cast<int>(kv::config::MAX_CONNECTIONS)) == SOCKET_ERROR) {
+    if (listen(listenFd, static_cast<int>(kv::config::LISTEN_BACKLOG)) == SOCKET_ERROR) {
         LOG_FATAL(std::string("listen failed: ") + std::to_string(WSAGetLastError()));
     }
 
     // Устанавливаем неблокирующий режим
     u_long mode = 1;
-    ioctlsocket(listenFd_, FIONBIO, &mode);
+    ioctlsocket(listenFd, FIONBIO, &mode);
 
 #else
-    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0) {
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
         LOG_ERROR(std::string("socket() failed: ") + std::strerror(errno));
         std::exit(EXIT_FAILURE);
     }
 
     int opt = 1;
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reusePort && setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR(std::string("setsockopt(SO_REUSEPORT) failed: ") + std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     inet_pton(AF_INET, address_.c_str(), &addr.sin_addr);
     addr.sin_port = htons(port_);
 
-    if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    if (::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0) {
         LOG_ERROR(std::string("bind() failed: ") + std::strerror(errno));
         std::exit(EXIT_FAILURE);
     }
-    if (::listen(listenFd_, static_cast<int>(kv::config::MAX_CONNECTIONS)) < 0) {
+    if (::listen(listenFd, static_cast<int>(kv::config::LISTEN_BACKLOG)) < 0) {
         LOG_ERROR(std::string("listen() failed: ") + std::strerror(errno));
         std::exit(EXIT_FAILURE);
     }
 
     // Устанавливаем неблокирующий режим
-    int flags = fcntl(listenFd_, F_GETFL, 0);
-    fcntl(listenFd_, F_SETFL, flags | O_NONBLOCK);
+    int flags = fcntl(listenFd, F_GETFL, 0);
+    fcntl(listenFd, F_SETFL, flags | O_NONBLOCK);
 #endif
+    return listenFd;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::run() {
+    if (coreThreads_ > 1) {
+        run_cores();
+    } else {
+        run_io_threads();
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+void Server<Key, Value, Hash, KeyEqual>::run_io_threads() {
+    setup_listening_sockets(ioThreads_);
+    defragCorePass_.assign(1, 0);
+
+    auto loop_main = [this](size_t loop) {
+        // Фоновые задачи обходят все шарды под их блокировками — достаточно одного потока.
+        if (loop == 0) {
+            if constexpr (Map::kSupportsExpiry) {
+                EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::EXPIRE_TICK_MS),
+                                                [this] { shardedMap_.expire_cycle(); });
+            }
+            EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::RESHARD_TICK_MS),
+                                            [this] { shardedMap_.reshard_cycle(); });
+            EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::POOL_TRIM_MS),
+                                            [this] { trim_memory(); });
+            if (defragCpuPercent_ != 0) {
+                EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::DEFRAG_TICK_MS),
+                                                [this] { defrag_cycle({}); });
+            }
+        }
+        // Корутина соединения живёт в потоке, который её принял, и возобновляется только его EventLoop.
+        accept_connections(listeners_[loop % listeners_.size()]);
+        EventLoop::instance().run();
+    };
+
+    std::vector<std::thread> loops;
+    for (size_t loop = 1; loop < ioThreads_; ++loop) {
+        loops.emplace_back(loop_main, loop);
+    }
 
     if constexpr (kv::config::ENABLE_DEBUG_LOG) {
-        LOG_INFO("The server is listening on " + address_ + ":" + std::to_string(port_));
-        LOG_INFO("  -> Thread pool size: " + std::to_string(kv::config::THREAD_POOL_SIZE));
-        LOG_INFO("  -> Shards in HashMap: " + std::to_string(kv::config::HASH_MAP_SHARDS));
-        LOG_INFO("  -> Max connections (backlog): " + std::to_string(kv::config::MAX_CONNECTIONS));
+        LOG_INFO("  -> I/O threads: " + std::to_string(ioThreads_));
+    }
+    loop_main(0);
+
+    for (auto& thread : loops) {
+        thread.join();
     }
 }
 
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
-void Server<Key, Value, Hash, KeyEqual>::run() {
-    setup_listening_socket();
-    EventLoop::instance().run();
+void Server<Key, Value, Hash, KeyEqual>::run_cores() {
+    if constexpr (!Map::kSupportsSingleWriter) {
+        // Ядра всё равно обслуживают соединения — как потоки ввода-вывода над общими шардами.
+        LOG_WARN("thread-per-core mode is not supported by this table type, using I/O threads instead");
+        ioThreads_ = std::max(ioThreads_, coreThreads_);
+        coreThreads_ = 1;
+        run_io_threads();
+    } else {
+        // Шарды больше не делятся между потоками: каждое ядро работает только со своими.
+        shardedMap_.set_single_writer(true);
+        setup_listening_sockets(coreThreads_);
+        mesh_ = std::make_unique<CoreMesh>(coreThreads_);
+        defragCorePass_.assign(coreThreads_, 0);
+        if (shardedMap_.shard_count() % coreThreads_ != 0) {
+            LOG_WARN("HASH_MAP_SHARDS is not a multiple of core threads: shards are spread unevenly");
+        }
+
+        std::latch attached(static_cast<std::ptrdiff_t>(coreThreads_));
+        auto core_main = [this, &attached](size_t core) {
+            mesh_->attach(core);
+            if constexpr (Map::kSupportsExpiry) {
+                EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::EXPIRE_TICK_MS),
+                                                [this, core] { shardedMap_.expire_cycle(owner_of(core)); });
+            }
+            // Пулы защищены своими мьютексами, так что арены возвращает одно ядро за всех.
+            if (core == 0) {
+                EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::POOL_TRIM_MS),
+                                                [this] { trim_memory(); });
+            }
+            if (defragCpuPercent_ != 0) {
+                EventLoop::instance().add_timer(std::chrono::milliseconds(kv::config::DEFRAG_TICK_MS),
+                                                [this, core] { defrag_cycle(owner_of(core)); });
+            }
+            // Соединения принимаются, только когда все ядра готовы принимать сообщения.
+            attached.arrive_and_wait();
+            accept_connections(listeners_[core % listeners_.size()]);
+            EventLoop::instance().run();
+        };
+
+        std::vector<std::thread> cores;
+        for (size_t core = 1; core < coreThreads_; ++core) {
+            cores.emplace_back(core_main, core);
+        }
+
+        if constexpr (kv::config::ENABLE_DEBUG_LOG) {
+            LOG_INFO("  -> Core threads: " + std::to_string(coreThreads_));
+        }
+        core_main(0);
+
+        for (auto& thread : cores) {
+            thread.join();
+        }
+    }
 }
 
-// Цикл принятия новых подключений
+// Приём новых подключений
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
-void Server<Key, Value, Hash, KeyEqual>::accept_loop() {
+Task Server<Key, Value, Hash, KeyEqual>::accept_connections(SOCKET_TYPE listenFd) {
+    // Готовые соединения забираются без возврата в цикл событий: с epoll — accept до EAGAIN,
+    // с io_uring — из очереди multishot accept. После иной ошибки (EMFILE) — ждём готовности.
+    bool failed = false;
     while (true) {
+        SOCKET_TYPE clientFd = co_await async_accept(listenFd, failed);
+        failed = false;
+        if (clientFd == kInvalidSocket) {
+            if (io_would_block()) {
+                continue;
+            }
 #ifdef _WIN32
-        fd_set readSet;
-        FD_ZERO(&readSet);
-        FD_SET(listenFd_, &readSet);
-
-        int ret = select(static_cast<int>(listenFd_ + 1), &readSet, nullptr, nullptr, nullptr);
-        if (ret == SOCKET_ERROR) {
-            int err = WSAGetLastError();
-            LOG_ERROR("select(listen) failed: " + std::to_string(err));
-            continue;
-        }
-        if (FD_ISSET(listenFd_, &readSet)) {
-            SOCKET_TYPE clientFd = accept(listenFd_, nullptr, nullptr);
-            if (clientFd == INVALID_SOCKET) {
-                int err = WSAGetLastError();
-                if (err == WSAEWOULDBLOCK) {
-                    continue;
-                }
-                LOG_ERROR("accept failed: " + std::to_string(err));
+            LOG_ERROR("accept failed: " + std::to_string(WSAGetLastError()));
+#else
+            if (errno == EINTR || errno == ECONNABORTED) {
                 continue;
             }
-            u_long mode = 1;
-            ioctlsocket(clientFd, FIONBIO, &mode);
-
-            handle_connection(clientFd);
+            LOG_ERROR(std::string("accept4() failed: ") + std::strerror(errno));
+#endif
+            failed = true;
+            continue;
         }
+
+        // Сверх лимита соединение закрывается сразу: оставить его в очереди listen нельзя —
+        // о нём уже сообщили, и нового пробуждения может не быть.
+        if (connections_.fetch_add(1, std::memory_order_relaxed) >= kv::config::MAX_CONNECTIONS) {
+            connections_.fetch_sub(1, std::memory_order_relaxed);
+            rejectedConnections_.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+            closesocket(clientFd);
 #else
-        fd_set readSet;
-        FD_ZERO(&readSet);
-        FD_SET(listenFd_, &readSet);
-        int ret = select(listenFd_ + 1, &readSet, nullptr, nullptr, nullptr);
-        if (ret < 0) {
-            if (errno == EINTR) continue;
-            LOG_ERROR(std::string("select(listen) failed: ") + std::strerror(errno));
+            close(clientFd);
+#endif
             continue;
         }
-        if (FD_ISSET(listenFd_, &readSet)) {
-            int clientFd = ::accept(listenFd_, nullptr, nullptr);
-            if (clientFd < 0) {
-                if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    continue;
-                }
-                LOG_ERROR(std::string("accept() failed: ") + std::strerror(errno));
-                continue;
-            }
-            int flags = fcntl(clientFd, F_GETFL, 0);
-            fcntl(clientFd, F_SETFL, flags | O_NONBLOCK);
 
-            handle_connection(clientFd);
-        }
-#endif
+        // Ответы уходят сразу, не дожидаясь подтверждения предыдущих (алгоритм Нейгла).
+        int one = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+        handle_connection(clientFd);
     }
 }
 
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
 Task Server<Key, Value, Hash, KeyEqual>::handle_connection(SOCKET_TYPE clientFd) {
-    char buffer[4096];
+    RequestBuffer input;
+    ResponseBuffer output;
+    std::vector<ValueRef> pinned;    // значения, на которые ссылается output
+    bool compressedReplies = false;  // COMPRESS ON: GET отдаёт сжатые значения как есть
+    std::string scratch;             // распакованное значение для ответа
 
     while (true) {
-        // Ждём данные для чтения, при этом корутина автоматически управляет неблокирующим I/O
-        ssize_t n = co_await async_read(clientFd, buffer, sizeof(buffer));
-        if (n <= 0) {
-            if constexpr (kv::config::ENABLE_DEBUG_LOG) {
-                LOG_INFO("Connection closed or read error, fd=" + std::to_string(clientFd));
+        // Команды выполняются по одной, пока в буфере есть полные строки; читаем, только когда их нет.
+        std::optional<std::string_view> line = input.next_line();
+        bool closing = !line && input.overflow();
+        if (closing) {
+            LOG_WARN("Request line exceeds MAX_REQUEST_SIZE, closing fd=" + std::to_string(clientFd));
+            output.append(reply::ERROR_TOO_LARGE);
+        }
+
+        // Ответы пачки уходят одной векторной записью — перед чтением, когда полных строк не осталось,
+        // или раньше, если их накопилось RESPONSE_FLUSH_BYTES. Недописанное ждёт готовности сокета.
+        if (!output.empty() && (!line || output.size() >= kv::config::RESPONSE_FLUSH_BYTES)) {
+            while (!output.empty()) {
+                std::span<const IoSlice> slices = output.slices();
+                ssize_t written = co_await async_writev(clientFd, slices.data(), slices.size());
+                if (written > 0) {
+                    output.consume(static_cast<size_t>(written));
+                } else if (written == 0 || !io_would_block()) {
+                    closing = true;
+                    break;
+                }
             }
+            pinned.clear();
+        }
+        if (closing) {
             break;
         }
 
-        // Преобразуем в std::string и убираем '\r' и '\n'
-        std::string req(buffer, buffer + n);
-        while (!req.empty() && (req.back() == '\r' || req.back() == '\n')) {
-            req.pop_back();
+        if (!line) {
+            // Ждём данные для чтения, при этом корутина автоматически управляет неблокирующим I/O
+            std::span<char> space = input.prepare();
+            ssize_t n = co_await async_read(clientFd, space.data(), space.size());
+            if (n < 0 && io_would_block()) {
+                continue;
+            }
+            if (n <= 0) {
+                if constexpr (kv::config::ENABLE_DEBUG_LOG) {
+                    LOG_INFO("Connection closed or read error, fd=" + std::to_string(clientFd));
+                }
+                break;
+            }
+            input.commit(static_cast<size_t>(n));
+            continue;
+        }
+
+        // Разбираем запрос прямо в буфере приёма: строка уже без "\r\n" и жива до следующего чтения.
+        std::string_view req = *line;
+        if (req.empty()) {
+            continue;
         }
 
-        if (req.rfind("GET ", 0) == 0) {
-            std::string key = req.substr(4);
-            auto opt = shardedMap_.get(key);
-            std::string resp = opt.has_value() ? opt.value() + "\n" : "NOT_FOUND\n";
-            co_await async_write(clientFd, resp.c_str(), resp.size());
+        if (req.starts_with("GET ")) {
+            std::string_view key = req.substr(4);
+            auto handle = co_await on_key_owner(key, [&] { return shardedMap_.get_ref(lookup_key(key)); });
+            if (handle) {
+                // Крупный буфер значения уходит в сокет без копирования и отпускается после записи.
+                // Сжатое значение распаковывается, если клиент не согласился принимать его сжатым.
+                char header[48];
+                char* headerEnd = header;
+                std::string_view payload;
+                bool unpacked = false;  // payload — распакованная копия в scratch
+                if (compressedReplies && handle.compressed()) {
+                    std::string_view packed = handle.value();
+                    payload = lz::packed_data(packed);
+                    headerEnd = format_header(header, "LZ ", {lz::unpacked_size(packed), payload.size()});
+                } else {
+                    payload = handle.plain(scratch);
+                    unpacked = handle.compressed();
+                    if (compressedReplies) {
+                        headerEnd = format_header(header, "VALUE ", {payload.size()});
+                    }
+                }
+                output.append({header, static_cast<size_t>(headerEnd - header)});
+                if (unpacked) {
+                    output.append(payload);
+                } else {
+                    append_value(output, pinned, std::move(handle), payload);
+                }
+                output.append("\n");
+            } else {
+                output.append(reply::NOT_FOUND);
+            }
 
-        } else if (req.rfind("SET ", 0) == 0) {
+        } else if (req.starts_with("SET ")) {
             size_t pos = req.find(' ', 4);
-            if (pos == std::string::npos) {
-                std::string resp = "ERROR\n";
-                co_await async_write(clientFd, resp.c_str(), resp.size());
+            if (pos == std::string_view::npos) {
+                output.append(reply::ERROR);
             } else {
-                std::string key = req.substr(4, pos - 4);
-                std::string val = req.substr(pos + 1);
+                std::string_view key = req.substr(4, pos - 4);
+                std::string_view val = req.substr(pos + 1);
+                std::uint64_t ttlSeconds = 0;
+                if constexpr (Map::kSupportsExpiry) {
+                    ttlSeconds = split_ttl(val);
+                }
                 if (key.size() > kv::config::MAX_KEY_SIZE || val.size() > kv::config::MAX_VALUE_SIZE) {
-                    std::string resp = "ERROR_TOO_LARGE\n";
-                    co_await async_write(clientFd, resp.c_str(), resp.size());
+                    output.append(reply::ERROR_TOO_LARGE);
+                } else {
+                    co_await on_key_owner(key, [&] {
+                        if constexpr (Map::kSupportsExpiry) {
+                            return shardedMap_.put(key, val, ttlSeconds ? now_ms() + ttlSeconds * 1000 : 0);
+                        } else if constexpr (TransparentLookup<Hash, KeyEqual>) {
+                            return shardedMap_.put(key, val);
+                        } else {
+                            return shardedMap_.put(Key(key), Value(val));
+                        }
+                    });
+                    output.append(reply::STORED);
+                }
+            }
+
+        } else if (req.starts_with("SETEX ")) {
+            // SETEX key seconds value -> STORED. Срок идёт отдельным аргументом перед значением,
+            // поэтому значение сохраняется как есть, даже если оканчивается на " EX <число>".
+            if constexpr (Map::kSupportsExpiry) {
+                std::string_view args = req.substr(6);
+                size_t keyEnd = args.find(' ');
+                size_t ttlEnd = keyEnd == std::string_view::npos ? keyEnd : args.find(' ', keyEnd + 1);
+                std::uint64_t seconds = 0;
+                if (ttlEnd == std::string_view::npos || keyEnd == 0 ||
+                    !parse_positive(args.substr(keyEnd + 1, ttlEnd - keyEnd - 1), seconds)) {
+                    output.append(reply::ERROR);
+                } else {
+                    std::string_view key = args.substr(0, keyEnd);
+                    std::string_view val = args.substr(ttlEnd + 1);
+                    if (key.size() > kv::config::MAX_KEY_SIZE || val.size() > kv::config::MAX_VALUE_SIZE) {
+                        output.append(reply::ERROR_TOO_LARGE);
+                    } else {
+                        co_await on_key_owner(
+                            key, [&] { return shardedMap_.put(key, val, now_ms() + seconds * 1000); });
+                        output.append(reply::STORED);
+                    }
+                }
+            } else {
+                output.append(reply::ERROR);
+            }
+
+        } else if (req.starts_with("MGET ")) {
+            // MGET k1 k2 ... -> по строке на ключ (значение | NOT_FOUND), затем END.
+            // Крупные значения уходят в сокет прямо из закреплённых буферов значений.
+            auto keys = batch_of(split_args(req.substr(5)));
+            if (keys.empty() || keys.size() > kv::config::MAX_BATCH_KEYS) {
+                output.append(reply::ERROR);
+                continue;
+            }
+            std::span<const typename decltype(keys)::value_type> keySpan(keys);
+            std::vector<ValueRef> handles(keys.size());
+            for (size_t core : cores_of(keys)) {
+                co_await run_on_core(mesh_.get(), core, [&, core] {
+                    shardedMap_.get_ref_many(keySpan, handles.data(), owner_of(core));
+                    return true;
+                });
+            }
+
+            for (auto& handle : handles) {
+                if (!handle) {
+                    output.append(reply::NOT_FOUND);
+                    continue;
+                }
+                if (handle.compressed()) {
+                    output.append(handle.plain(scratch));
+                } else {
+                    std::string_view value = handle.value();
+                    append_value(output, pinned, std::move(handle), value);
+                }
+                output.append("\n");
+            }
+            output.append("END\n");
+
+        } else if (req.starts_with("MSET ")) {
+            // MSET k1 v1 k2 v2 ... -> STORED (значения без пробелов, без TTL)
+            std::vector<std::string_view> args = split_args(req.substr(5));
+            std::string_view resp = reply::STORED;
+            if (args.empty() || args.size() % 2 != 0 || args.size() / 2 > kv::config::MAX_BATCH_KEYS) {
+                resp = reply::ERROR;
+            } else {
+                std::vector<std::string_view> keys, values;
+                keys.reserve(args.size() / 2);
+                values.reserve(args.size() / 2);
+                for (size_t i = 0; i < args.size(); i += 2) {
+                    if (args[i].size() > kv::config::MAX_KEY_SIZE || args[i + 1].size() > kv::config::MAX_VALUE_SIZE) {
+                        resp = reply::ERROR_TOO_LARGE;
+                    }
+                    keys.push_back(args[i]);
+                    values.push_back(args[i + 1]);
+                }
+                if (resp == reply::STORED) {
+                    auto batchKeys = batch_of(std::move(keys));
+                    auto batchValues = batch_of<Value>(std::move(values));
+                    std::span<const typename decltype(batchKeys)::value_type> keySpan(batchKeys);
+                    std::span<const typename decltype(batchValues)::value_type> valueSpan(batchValues);
+                    for (size_t core : cores_of(batchKeys)) {
+                        co_await run_on_core(mesh_.get(), core, [&, core] {
+                            shardedMap_.put_many(keySpan, valueSpan, owner_of(core));
+                            return true;
+                        });
+                    }
+                }
+            }
+            output.append(resp);
+
+        } else if (req.starts_with("MDEL ")) {
+            // MDEL k1 k2 ... -> число удалённых ключей
+            auto keys = batch_of(split_args(req.substr(5)));
+            if (keys.empty() || keys.size() > kv::config::MAX_BATCH_KEYS) {
+                output.append(reply::ERROR);
+                continue;
+            }
+            std::span<const typename decltype(keys)::value_type> keySpan(keys);
+            size_t erased = 0;
+            for (size_t core : cores_of(keys)) {
+                erased += co_await run_on_core(mesh_.get(), core,
+                                               [&, core] { return shardedMap_.erase_many(keySpan, owner_of(core)); });
+            }
+            char out[24];
+            output.append({out, format_integer(out, static_cast<std::int64_t>(erased))});
+
+        } else if (req.starts_with("DEL ")) {
+            std::string_view key = req.substr(4);
+            bool erased = co_await on_key_owner(key, [&] { return shardedMap_.erase(lookup_key(key)); });
+            std::string_view resp = erased ? reply::DELETED : reply::NOT_FOUND;
+            output.append(resp);
+
+        } else if (req.starts_with("INCR ") || req.starts_with("DECR ") || req.starts_with("INCRBY ")) {
+            // INCR key | DECR key | INCRBY key delta -> новое значение
+            std::string_view key = req.substr(req.find(' ') + 1);
+            std::int64_t delta = req.starts_with("DECR ") ? -1 : 1;
+            std::optional<std::int64_t> value;
+            std::string_view resp = reply::ERROR;
+            if (req.starts_with("INCRBY ")) {
+                size_t pos = key.find(' ');
+                bool valid = pos != std::string_view::npos && parse_integer(key.substr(pos + 1), delta);
+                key = valid ? key.substr(0, pos) : std::string_view{};
+            }
+            if (key.size() > kv::config::MAX_KEY_SIZE) {
+                resp = reply::ERROR_TOO_LARGE;
+            } else if (!key.empty()) {
+                value = co_await on_key_owner(key, [&] { return increment(key, delta); });
+                resp = reply::ERROR_NOT_INTEGER;
+            }
+            if (value) {
+                char out[24];
+                output.append({out, format_integer(out, *value)});
+            } else {
+                output.append(resp);
+            }
+
+        } else if (req.starts_with("APPEND ")) {
+            // APPEND key suffix -> новая длина значения
+            size_t pos = req.find(' ', 7);
+            std::optional<size_t> length;
+            std::string_view resp = reply::ERROR;
+            if (pos != std::string_view::npos) {
+                resp = reply::ERROR_TOO_LARGE;
+                std::string_view key = req.substr(7, pos - 7);
+                if (key.size() <= kv::config::MAX_KEY_SIZE) {
+                    length = co_await on_key_owner(key, [&] { return append(key, req.substr(pos + 1)); });
+                }
+            }
+            if (length) {
+                char out[24];
+                output.append({out, format_integer(out, static_cast<std::int64_t>(*length))});
+            } else {
+                output.append(resp);
+            }
+
+        } else if (req.starts_with("CAS ")) {
+            // CAS key expected new -> STORED | EXISTS | NOT_FOUND
+            std::string_view args = req.substr(4);
+            size_t keyEnd = args.find(' ');
+            size_t expectedEnd = keyEnd == std::string_view::npos ? keyEnd : args.find(' ', keyEnd + 1);
+            std::string_view resp = reply::ERROR;
+            if (expectedEnd != std::string_view::npos) {
+                std::string_view key = args.substr(0, keyEnd);
+                std::string_view expected = args.substr(keyEnd + 1, expectedEnd - keyEnd - 1);
+                std::string_view desired = args.substr(expectedEnd + 1);
+                if (key.empty() || expected.empty()) {
+                    // Двойной пробел между аргументами — ошибка формата, а не пустой ключ или значение.
+                    resp = reply::ERROR;
+                } else if (key.size() > kv::config::MAX_KEY_SIZE || desired.size() > kv::config::MAX_VALUE_SIZE) {
+                    resp = reply::ERROR_TOO_LARGE;
                 } else {
-                    shardedMap_.put(key, val);
-                    std::string resp = "STORED\n";
-                    co_await async_write(clientFd, resp.c_str(), resp.size());
+                    resp = co_await on_key_owner(key, [&] { return compare_and_set(key, expected, desired); });
+                }
+            }
+            output.append(resp);
+
+        } else if (req.starts_with("EXPIRE ")) {
+            // EXPIRE key seconds -> OK | NOT_FOUND
+            std::string_view resp = reply::ERROR;
+            if constexpr (Map::kSupportsExpiry) {
+                std::string_view args = req.substr(7);
+                size_t pos = args.find(' ');
+                std::uint64_t seconds = 0;
+                if (pos != std::string_view::npos && parse_positive(args.substr(pos + 1), seconds)) {
+                    std::string_view key = args.substr(0, pos);
+                    bool found = co_await on_key_owner(
+                        key, [&] { return shardedMap_.expire(key, now_ms() + seconds * 1000); });
+                    resp = found ? reply::OK : reply::NOT_FOUND;
                 }
             }
+            output.append(resp);
 
-        } else if (req.rfind("DEL ", 0) == 0) {
-            std::string key = req.substr(4);
-            bool erased = shardedMap_.erase(key);
-            std::string resp = erased ? "DELETED\n" : "NOT_FOUND\n";
-            co_await async_write(clientFd, resp.c_str(), resp.size());
+        } else if (req.starts_with("TTL ")) {
+            // TTL key -> оставшиеся секунды | -1 (без срока) | -2 (нет ключа)
+            if constexpr (Map::kSupportsExpiry) {
+                std::string_view key = req.substr(4);
+                std::int64_t ttl = co_await on_key_owner(key, [&] { return shardedMap_.ttl(key); });
+                if (ttl > 0) {
+                    ttl = (ttl + 999) / 1000;
+                }
+                char out[24];
+                output.append({out, format_integer(out, ttl)});
+            } else {
+                output.append(reply::ERROR);
+            }
+
+        } else if (kCanScan && req.starts_with("SCAN ")) {
+            std::string resp;
+            if constexpr (kCanScan) {
+                // Шаг SCAN выполняет ядро, которому принадлежит шард курсора.
+                std::string_view args = req.substr(5);
+                size_t start = std::min(args.find_first_not_of(' '), args.size());
+                std::uint64_t cursor = 0;
+                std::from_chars(args.data() + start, args.data() + args.size(), cursor);
+                resp = co_await run_on_core(mesh_.get(), owner_core(shardedMap_.scan_shard(cursor)),
+                                            [&] { return scan(args); });
+            }
+            if (resp.empty()) {
+                resp = reply::ERROR;
+            }
+            output.append(resp);
+
+        } else if (req == "COMPRESS ON" || req == "COMPRESS OFF") {
+            // COMPRESS ON -> OK: дальше GET отвечает "LZ <исходная длина> <длина>" или "VALUE <длина>",
+            // затем байты значения (сжатые — как хранятся) и '\n'.
+            compressedReplies = req == "COMPRESS ON";
+            output.append(reply::OK);
+
+        } else if (req.starts_with("RESHARD ")) {
+            // RESHARD count -> OK (шарды делятся в фоне) | ERROR
+            std::uint64_t count = 0;
+            bool ok = parse_positive(req.substr(8), count) && shardedMap_.grow_shards(static_cast<size_t>(count));
+            std::string_view resp = ok ? reply::OK : reply::ERROR;
+            output.append(resp);
+
+        } else if (req == "INFO" || req.starts_with("INFO ")) {
+            // INFO [section] -> строки "имя:значение" и END | ERROR (неизвестная секция)
+            std::string resp = info(req.size() > 5 ? req.substr(5) : std::string_view{});
+            if (resp.empty()) {
+                resp = reply::ERROR;
+            }
+            output.append(resp);
+
+        } else if (Map::kSupportsEviction && req.starts_with("MEMORY USAGE ")) {
+            // MEMORY USAGE key -> байты, которые занимает ключ | NOT_FOUND
+            std::optional<size_t> bytes;
+            if constexpr (Map::kSupportsEviction) {
+                std::string_view key = req.substr(13);
+                bytes = co_await on_key_owner(key, [&] { return shardedMap_.memory_usage(lookup_key(key)); });
+            }
+            if (bytes) {
+                char out[24];
+                output.append({out, format_integer(out, static_cast<std::int64_t>(*bytes))});
+            } else {
+                output.append(reply::NOT_FOUND);
+            }
 
         } else {
-            std::string resp = "ERROR\n";
-            co_await async_write(clientFd, resp.c_str(), resp.size());
+            output.append(reply::ERROR);
         }
     }
 
-#ifdef _WIN32
-    closesocket(clientFd);
-#else
-    close(clientFd);
-#endif
+    // Через цикл: он забывает готовность дескриптора, номер которого достанется следующему соединению.
+    EventLoop::instance().remove(clientFd);
+    connections_.fetch_sub(1, std::memory_order_relaxed);
     co_return;
 }
 
@@ -1,63 +1,663 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <thread>
 #include <vector>
 
 #include "config.hpp"
+#include "kv/flat_hash_table.hpp"
 #include "kv/hash_table.hpp"
 
 namespace kv {
 
+// Подмножество шардов, с которым работает вызов. В режиме ядро-на-поток шард s принадлежит
+// ядру s % cores, и ядро обращается только к своим шардам; по умолчанию — все шарды.
+struct ShardOwner {
+    size_t core = 0;
+    size_t cores = 1;
+
+    bool owns(size_t shard) const { return shard % cores == core; }
+};
+
 /*
     Класс ShardedHashMap хранит numShards независимых HashTable и
     делегирует в них операции put/get/erase в зависимости от ключа.
+    Тип сегмента задаётся параметром Table: по умолчанию HashTable (цепочки),
+    либо FlatHashTable (открытая адресация) — у них одинаковый API.
+
+    Число шардов можно увеличивать на ходу (grow_shards) по схеме линейного хеширования:
+    base — число шардов в начале «круга», split — сколько из них в этом круге уже разделено.
+    Ключ живёт в шарде hash % base, а если тот уже разделён (< split) — в hash % (2 * base).
+    Шарды делятся по одному, по порядку: шард split отдаёт новому шарду split + base ключи с
+    hash % (2 * base) == split + base; когда разделены все base шардов, base удваивается.
+    Ключи переходят только в шарды с большим номером, остальные шарды разделение не замечают.
+
+    Перенос идёт порциями из EventLoop (reshard_cycle), и на время порции блокируется только
+    шард-источник. Пока он делится, его «уходящие» ключи могут быть в любом из двух шардов:
+    читатель смотрит сначала в источник, потом в приёмник (перенос кладёт узел в приёмник
+    раньше, чем убирает из источника), а писатель сначала переносит ключ сам и пишет уже
+    в приёмник. Писатели берут блокировку разделения шарда (splitLocks_) — так они не
+    пересекаются с порцией переноса; читатели её не берут, а промах перепроверяют по routing_.
 */
-template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Key, typename Value, typename Hash = DefaultHash<Key>, typename KeyEqual = DefaultKeyEqual<Key>,
+          typename Table = HashTable<Key, Value, Hash, KeyEqual>>
 class ShardedHashMap {
    public:
-    explicit ShardedHashMap(size_t numShards = kv::config::HASH_MAP_SHARDS) : numShards_(numShards) {
-        shards_.reserve(numShards_);
-        for (size_t i = 0; i < numShards_; ++i) {
-            shards_.push_back(
-                std::make_unique<HashTable<Key, Value, Hash, KeyEqual>>());
+    // TTL доступен, если его поддерживает тип сегмента (HashTable с упакованными узлами).
+    static constexpr bool kSupportsExpiry = requires { requires Table::kSupportsExpiry; };
+
+    // Сжатие крупных значений (HashTable с упакованными узлами).
+    static constexpr bool kSupportsCompression = requires { requires Table::kSupportsCompression; };
+
+    // Бюджет памяти и вытеснение доступны, если сегмент ведёт учёт памяти (HashTable).
+    static constexpr bool kSupportsEviction = requires(Table& t) {
+        t.set_max_memory(size_t{}, kv::config::EVICTION_POLICY);
+        t.evictions();
+        t.memory_stats();
+        t.trim_memory();
+    };
+
+    // Активная дефрагментация узлов (HashTable).
+    static constexpr bool kSupportsDefrag = requires(Table& t) {
+        t.defrag_step(size_t{});
+        t.defrag_rewind();
+        t.defrag_stats();
+    };
+
+    // Шарды без блокировок: каждый шард используется только потоком-владельцем (set_single_writer).
+    static constexpr bool kSupportsSingleWriter = requires(Table& t) { t.set_single_writer(true); };
+
+    // Увеличение числа шардов на ходу: сегмент умеет переносить ключи в другой (HashTable).
+    static constexpr bool kSupportsResharding = requires(Table& t, const Key& key) { t.move_key(key, t); };
+
+    explicit ShardedHashMap(size_t numShards = kv::config::HASH_MAP_SHARDS)
+        : maxShards_(std::max(numShards, kv::config::MAX_HASH_MAP_SHARDS)),
+          shards_(new std::unique_ptr<Table>[maxShards_]),
+          splitLocks_(new SplitLock[maxShards_]),
+          routing_(encode_routing(numShards, 0, false)),
+          targetShards_(numShards) {
+        for (size_t i = 0; i < numShards; ++i) {
+            shards_[i] = std::make_unique<Table>();
+        }
+        if constexpr (kSupportsEviction) {
+            set_max_memory(kv::config::MAX_MEMORY_BYTES, kv::config::EVICTION_POLICY);
         }
     };
 
     // Вставка или обновление. Возвращает true, если успешно.
     bool put(const Key& key, const Value& value) {
-        size_t idx = getShardIndex(key);
-        return shards_[idx]->put(key, value);
+        return write_routed(key, [&](Table& shard) { return shard.put(key, value); });
+    }
+
+    template <typename K, typename V>
+        requires TransparentLookup<Hash, KeyEqual>
+    bool put(const K& key, const V& value) {
+        return write_routed(key, [&](Table& shard) { return shard.put(key, value); });
+    }
+
+    // Вставка со сроком жизни (deadlineMs по now_ms()).
+    template <typename K, typename V>
+        requires kSupportsExpiry
+    bool put(const K& key, const V& value, std::uint64_t deadlineMs) {
+        return write_routed(key, [&](Table& shard) { return shard.put(key, value, deadlineMs); });
     }
 
     // Чтение: если есть, вернёт std::optional с копией value, иначе пустой optional.
     std::optional<Value> get(const Key& key) const {
-        size_t idx = getShardIndex(key);
-        return shards_[idx]->get(key);
+        return read_routed(key, [&](const Table& shard) { return shard.get(key); });
+    }
+
+    // То же по ключу совместимого типа (std::string_view и т.п.) при прозрачных Hash/KeyEqual.
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    std::optional<Value> get(const K& key) const {
+        return read_routed(key, [&](const Table& shard) { return shard.get(key); });
+    }
+
+    // Чтение без копирования: закреплённый неизменяемый буфер значения (пустой, если ключа нет).
+    auto get_ref(const Key& key) const {
+        return read_routed(key, [&](const Table& shard) { return shard.get_ref(key); });
+    }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    auto get_ref(const K& key) const {
+        return read_routed(key, [&](const Table& shard) { return shard.get_ref(key); });
     }
 
     // Удаление: true, если элемент был и удалён, false, если элемента не было.
     bool erase(const Key& key) {
-        size_t idx = getShardIndex(key);
-        return shards_[idx]->erase(key);
+        return write_routed(key, [&](Table& shard) { return shard.erase(key); });
+    }
+
+    template <typename K>
+        requires TransparentLookup<Hash, KeyEqual>
+    bool erase(const K& key) {
+        return write_routed(key, [&](Table& shard) { return shard.erase(key); });
+    }
+
+    // Чтение-изменение-запись под одной блокировкой шарда (см. HashTable::update).
+    template <typename K, typename Fn>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    bool update(const K& key, Fn&& fn) {
+        return write_routed(key, [&](Table& shard) { return shard.update(key, fn); });
+    }
+
+    template <typename K>
+        requires kSupportsExpiry
+    bool expire(const K& key, std::uint64_t deadlineMs) {
+        return write_routed(key, [&](Table& shard) { return shard.expire(key, deadlineMs); });
+    }
+
+    // Оставшееся время жизни в мс: -1 — ключ бессрочный, -2 — ключа нет.
+    template <typename K>
+        requires kSupportsExpiry
+    std::int64_t ttl(const K& key) const {
+        return read_routed(key, [&](const Table& shard) { return shard.ttl(key); },
+                           [](std::int64_t ttl) { return ttl != -2; });
+    }
+
+    // Активное истечение ключей; вызывается периодически из EventLoop.
+    // Шарды обходятся по кругу порциями по EXPIRE_SLICE_KEYS ключей (каждая — одна короткая
+    // блокировка шарда), пока есть просроченные ключи и не исчерпан EXPIRE_CYCLE_BUDGET_US.
+    void expire_cycle(ShardOwner owner = {})
+        requires kSupportsExpiry
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto budget = std::chrono::microseconds(kv::config::EXPIRE_CYCLE_BUDGET_US);
+        std::uint64_t nowMs = now_ms();
+        bool more = true;
+        while (more && std::chrono::steady_clock::now() - start < budget) {
+            more = false;
+            size_t count = shard_count();
+            for (size_t s = owner.core; s < count; s += owner.cores) {
+                more |= shards_[s]->expire_step(nowMs, kv::config::EXPIRE_SLICE_KEYS);
+            }
+        }
+    }
+
+    // Общий бюджет делится поровну: каждый шард вытесняет у себя сам, без глобальной блокировки.
+    // После разделения шарда бюджет перераспределяется на новое число шардов.
+    void set_max_memory(size_t bytes, kv::config::EvictionPolicy policy)
+        requires kSupportsEviction
+    {
+        std::lock_guard lock(reshardMutex_);
+        maxMemory_ = bytes;
+        policy_ = policy;
+        apply_memory_budget();
+    }
+
+    size_t memory_usage() const
+        requires kSupportsEviction
+    {
+        size_t total = 0;
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            total += shards_[s]->memory_usage();
+        }
+        return total;
+    }
+
+    // Разбивка памяти по всем шардам (сумма memory_stats).
+    MemoryStats memory_stats() const
+        requires kSupportsEviction
+    {
+        MemoryStats total;
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            total += shards_[s]->memory_stats();
+        }
+        return total;
+    }
+
+    // Учтённая память шарда s (s < shard_count()).
+    size_t shard_memory_usage(size_t s) const
+        requires kSupportsEviction
+    {
+        return shards_[s]->memory_usage();
+    }
+
+    // Возвращает системе пустые арены пулов узлов всех шардов; вызывается периодически из EventLoop.
+    size_t trim_memory()
+        requires kSupportsEviction
+    {
+        size_t released = 0;
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            released += shards_[s]->trim_memory();
+        }
+        return released;
+    }
+
+    // Активная дефрагментация; вызывается периодически из EventLoop, как expire_cycle.
+    // Шарды обходятся по кругу порциями по DEFRAG_SLICE_KEYS узлов (каждая — одна короткая
+    // блокировка шарда), пока не исчерпан budget. true — все шарды прошли свой проход
+    // (или дефрагментация не нужна); следующий вызов начнёт новый.
+    bool defrag_cycle(std::chrono::microseconds budget, ShardOwner owner = {})
+        requires kSupportsDefrag
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool more = true;
+        while (more) {
+            if (std::chrono::steady_clock::now() - start >= budget) {
+                return false;
+            }
+            more = false;
+            size_t count = shard_count();
+            for (size_t s = owner.core; s < count; s += owner.cores) {
+                more |= shards_[s]->defrag_step(kv::config::DEFRAG_SLICE_KEYS);
+            }
+        }
+        for (size_t s = owner.core, count = shard_count(); s < count; s += owner.cores) {
+            shards_[s]->defrag_rewind();
+        }
+        return true;
+    }
+
+    DefragStats defrag_stats() const
+        requires kSupportsDefrag
+    {
+        DefragStats total;
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            total += shards_[s]->defrag_stats();
+        }
+        return total;
+    }
+
+    // Память одного ключа; nullopt — ключа нет.
+    template <typename K>
+        requires kSupportsEviction && (std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>)
+    std::optional<size_t> memory_usage(const K& key) const {
+        return read_routed(key, [&](const Table& shard) { return shard.memory_usage(key); });
+    }
+
+    std::uint64_t evictions() const
+        requires kSupportsEviction
+    {
+        std::uint64_t total = 0;
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            total += shards_[s]->evictions();
+        }
+        return total;
+    }
+
+    // Запрашивает рост до count шардов (не больше MAX_HASH_MAP_SHARDS); сами шарды делятся
+    // позже, в reshard_cycle. Уменьшать число шардов нельзя, как и делить шарды в режиме
+    // ядро-на-поток: владение шардом там задано его номером. false — запрос отклонён.
+    bool grow_shards(size_t count) {
+        if constexpr (kSupportsResharding) {
+            std::lock_guard lock(reshardMutex_);
+            if (singleWriter_ || count < targetShards_ || count > maxShards_) {
+                return false;
+            }
+            targetShards_ = count;
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    // Идёт ли разделение шардов (запрошенное число ещё не достигнуто).
+    bool resharding() const {
+        std::lock_guard lock(reshardMutex_);
+        return shard_count() < targetShards_;
+    }
+
+    // Фоновый перенос ключей; вызывается периодически из EventLoop, как expire_cycle.
+    // Порции по RESHARD_SLICE_KEYS узлов, пока есть работа и не исчерпан RESHARD_CYCLE_BUDGET_US.
+    void reshard_cycle() {
+        if constexpr (kSupportsResharding) {
+            auto start = std::chrono::steady_clock::now();
+            auto budget = std::chrono::microseconds(kv::config::RESHARD_CYCLE_BUDGET_US);
+            while (reshard_step() && std::chrono::steady_clock::now() - start < budget) {
+            }
+        }
+    }
+
+    // Пакетные операции (MGET/MSET/MDEL): ключи группируются по шардам, и каждый шард
+    // обрабатывает свою группу за один вход в эпоху (чтение) или одно взятие блокировки (запись).
+    // Хеш каждого ключа считается один раз. Результаты — в порядке ключей запроса.
+    // owner ограничивает вызов шардами одного ядра: ключи чужих шардов пропускаются.
+    // Если во время вызова делится шард, его ключи обрабатываются по одному, как в get/put/erase.
+    template <typename K>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    auto get_ref_many(std::span<const K> keys) const {
+        std::vector<typename Table::Handle> out(keys.size());
+        get_ref_many(keys, out.data());
+        return out;
+    }
+
+    template <typename K, typename Handle>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    void get_ref_many(std::span<const K> keys, Handle* out, ShardOwner owner = {}) const {
+        std::uint64_t state = routing_.load(std::memory_order_acquire);
+        for_each_shard_group(keys, state, owner, [&](size_t s, std::span<const BatchSlot> slots) {
+            shards_[s]->get_ref_batch(keys, slots, out);
+            if (!(state & kSplitting) && routing_.load(std::memory_order_acquire) == state) {
+                return;
+            }
+            // Шарды менялись: промах мог быть ложным — такие ключи перечитываются по одному.
+            for (const BatchSlot& slot : slots) {
+                if (!out[slot.index]) {
+                    out[slot.index] = get_ref(keys[slot.index]);
+                }
+            }
+        });
+    }
+
+    template <typename K, typename V>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    void put_many(std::span<const K> keys, std::span<const V> values, ShardOwner owner = {}) {
+        std::uint64_t state = routing_.load(std::memory_order_acquire);
+        for_each_shard_group(keys, state, owner, [&](size_t s, std::span<const BatchSlot> slots) {
+            if (lock_stable_shard(s, state, [&] { shards_[s]->put_batch(keys, values, slots); })) {
+                return;
+            }
+            for (const BatchSlot& slot : slots) {
+                const K& key = keys[slot.index];
+                write_routed(key, [&](Table& shard) { return shard.put(key, values[slot.index]); });
+            }
+        });
+    }
+
+    // Возвращает число удалённых ключей.
+    template <typename K>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    size_t erase_many(std::span<const K> keys, ShardOwner owner = {}) {
+        size_t erased = 0;
+        std::uint64_t state = routing_.load(std::memory_order_acquire);
+        for_each_shard_group(keys, state, owner, [&](size_t s, std::span<const BatchSlot> slots) {
+            if (lock_stable_shard(s, state, [&] { erased += shards_[s]->erase_batch(keys, slots); })) {
+                return;
+            }
+            for (const BatchSlot& slot : slots) {
+                const K& key = keys[slot.index];
+                erased += write_routed(key, [&](Table& shard) { return shard.erase(key); });
+            }
+        });
+        return erased;
+    }
+
+    // SCAN по всем шардам. Курсор без состояния на сервере: cursor % MAX_HASH_MAP_SHARDS — шард,
+    // cursor / MAX_HASH_MAP_SHARDS — курсор внутри шарда (0 — начало и конец обхода), так что
+    // курсор переживает рост числа шардов. Шарды обходятся по возрастанию номера, а ключи при
+    // разделении уходят только в шарды с большим номером — ключ, пролежавший в карте весь обход,
+    // всё равно будет выдан. За один вызов просматривается около count ключей; шарды блокируются
+    // по очереди, каждый на одну порцию. С owner вызов не переходит на шард другого ядра,
+    // а возвращает курсор его начала.
+    template <typename Fn>
+        requires requires(Table& t, Fn& fn) { t.scan(std::uint64_t{}, size_t{}, fn); }
+    std::uint64_t scan(std::uint64_t cursor, size_t count, Fn&& fn, ShardOwner owner = {}) {
+        size_t shard = scan_shard(cursor);
+        std::uint64_t inner = cursor / maxShards_;
+        size_t seen = 0;
+        auto counting = [&](const auto& key) {
+            ++seen;
+            fn(key);
+        };
+        while (shard < shard_count()) {
+            inner = shards_[shard]->scan(inner, count - seen, counting);
+            if (inner != 0) {
+                return inner * maxShards_ + shard;
+            }
+            if (++shard == shard_count()) {
+                return 0;
+            }
+            if (seen >= count || !owner.owns(shard)) {
+                return shard;
+            }
+        }
+        return 0;
+    }
+
+    // Шард, с которого продолжится SCAN с этим курсором.
+    size_t scan_shard(std::uint64_t cursor) const { return static_cast<size_t>(cursor % maxShards_); }
+
+    // Число созданных шардов (вместе с тем, в который сейчас переносятся ключи).
+    size_t shard_count() const {
+        std::uint64_t state = routing_.load(std::memory_order_acquire);
+        return routing_base(state) + routing_split(state) + ((state & kSplitting) ? 1 : 0);
+    }
+
+    // Шард ключа (для выбора ядра-владельца).
+    template <typename K>
+        requires std::is_same_v<K, Key> || TransparentLookup<Hash, KeyEqual>
+    size_t shard_of(const K& key) const {
+        return route(routing_.load(std::memory_order_acquire), hash_(key)).shard;
+    }
+
+    // Режим ядро-на-поток: с каждым шардом работает только поток его ядра, и блокировки
+    // писателей шардов отключаются. Вызывать до начала работы с картой.
+    void set_single_writer(bool enabled)
+        requires kSupportsSingleWriter
+    {
+        std::lock_guard lock(reshardMutex_);
+        singleWriter_ = enabled;
+        for (size_t s = 0; s < maxShards_; ++s) {
+            splitLocks_[s].mutex.set_enabled(!enabled);
+        }
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            shards_[s]->set_single_writer(enabled);
+        }
     }
 
     size_t size() const {
         size_t total = 0;
-        for (const auto& tablePtr : shards_) {
-            total += tablePtr->size();
+        for (size_t s = 0, count = shard_count(); s < count; ++s) {
+            total += shards_[s]->size();
         }
         return total;
     };
 
    private:
-    size_t getShardIndex(const Key& key) const {
-        return hash_(key) % numShards_;
+    // routing_: младшие 32 бита — base, следующие 31 — split, старший — идёт перенос шарда split.
+    // Значение только растёт, поэтому читателю достаточно сравнить его до и после поиска.
+    static constexpr std::uint64_t kSplitting = std::uint64_t{1} << 63;
+
+    static std::uint64_t encode_routing(size_t base, size_t split, bool splitting) {
+        return static_cast<std::uint64_t>(base) | (static_cast<std::uint64_t>(split) << 32) |
+               (splitting ? kSplitting : 0);
     }
+    static size_t routing_base(std::uint64_t state) { return static_cast<size_t>(state & 0xffffffffu); }
+    static size_t routing_split(std::uint64_t state) { return static_cast<size_t>((state >> 32) & 0x7fffffffu); }
 
-    size_t numShards_;
-    std::vector<std::unique_ptr<HashTable<Key, Value, Hash, KeyEqual>>> shards_;
+    // Шард ключа; для ключа, который сейчас переносится, shard — источник, target — приёмник.
+    struct Route {
+        size_t shard;
+        size_t target;
+    };
+
+    static Route route(std::uint64_t state, size_t h) {
+        size_t base = routing_base(state);
+        size_t split = routing_split(state);
+        size_t shard = h % base;
+        if (shard < split) {
+            shard = h % (2 * base);
+            return {shard, shard};
+        }
+        if (shard == split && (state & kSplitting) && h % (2 * base) == split + base) {
+            return {shard, split + base};
+        }
+        return {shard, shard};
+    }
+
+    // Блокировка разделения шарда: своя кэш-линия, чтобы писатели соседних шардов не мешали друг другу.
+    struct alignas(64) SplitLock {
+        ShardMutex mutex;
+    };
+
+    // Чтение: fn(shard) в шарде ключа (у переносимого ключа — сначала в источнике, потом в приёмнике).
+    // Промах повторяется, если за время поиска сменилась маршрутизация: ключ мог уйти в другой шард.
+    // hit(result) отличает найденный ключ от промаха (по умолчанию — приведение к bool).
+    template <typename K, typename Fn>
+    auto read_routed(const K& key, Fn&& fn) const {
+        return read_routed(key, fn, [](const auto& result) { return static_cast<bool>(result); });
+    }
+
+    template <typename K, typename Fn, typename Hit>
+    auto read_routed(const K& key, Fn&& fn, Hit&& hit) const {
+        size_t h = hash_(key);
+        while (true) {
+            std::uint64_t state = routing_.load(std::memory_order_acquire);
+            Route r = route(state, h);
+            auto result = fn(*shards_[r.shard]);
+            if (hit(result)) {
+                return result;
+            }
+            if (r.target != r.shard) {
+                result = fn(*shards_[r.target]);
+                if (hit(result)) {
+                    return result;
+                }
+            }
+            if (routing_.load(std::memory_order_acquire) == state) {
+                return result;
+            }
+        }
+    }
+
+    // Запись: fn(shard) под блокировкой разделения шарда ключа, так что порция переноса не идёт
+    // одновременно с ней. Переносимый ключ сначала переезжает в приёмник, и запись идёт туда.
+    template <typename K, typename Fn>
+    auto write_routed(const K& key, Fn&& fn) {
+        size_t h = hash_(key);
+        std::uint64_t state = routing_.load(std::memory_order_acquire);
+        if constexpr (!kSupportsResharding) {
+            return fn(*shards_[route(state, h).shard]);
+        } else {
+            while (true) {
+                size_t s = route(state, h).shard;
+                std::lock_guard lock(splitLocks_[s].mutex);
+                // Маршрут шарда s меняется только под его блокировкой — дальше он стабилен.
+                state = routing_.load(std::memory_order_acquire);
+                Route r = route(state, h);
+                if (r.shard != s) {
+                    continue;
+                }
+                if (r.target != r.shard) {
+                    shards_[s]->move_key(key, *shards_[r.target]);
+                }
+                return fn(*shards_[r.target]);
+            }
+        }
+    }
+
+    // Выполняет пакетную запись fn под блокировкой разделения шарда s, если маршрутизация
+    // с момента группировки (state) не менялась и шард s не делится. Иначе — false.
+    template <typename Fn>
+    bool lock_stable_shard(size_t s, std::uint64_t state, Fn&& fn) {
+        if constexpr (!kSupportsResharding) {
+            fn();
+            return true;
+        } else {
+            std::lock_guard lock(splitLocks_[s].mutex);
+            if ((state & kSplitting) || routing_.load(std::memory_order_acquire) != state) {
+                return false;
+            }
+            fn();
+            return true;
+        }
+    }
+
+    // Один шаг разделения: начать делить следующий шард или перенести порцию его ключей.
+    // Возвращает true, если работа ещё осталась.
+    bool reshard_step()
+        requires kSupportsResharding
+    {
+        std::lock_guard guard(reshardMutex_);
+        std::uint64_t state = routing_.load(std::memory_order_relaxed);
+        size_t base = routing_base(state);
+        size_t split = routing_split(state);
+        size_t target = base + split;
+        if (!(state & kSplitting)) {
+            if (target >= targetShards_) {
+                return false;
+            }
+            shards_[target] = std::make_unique<Table>();
+            if constexpr (kSupportsEviction) {
+                shards_[target]->set_max_memory(0, policy_);
+            }
+            std::lock_guard lock(splitLocks_[split].mutex);
+            migrateCursor_ = 0;
+            routing_.store(encode_routing(base, split, true), std::memory_order_release);
+            if constexpr (kSupportsEviction) {
+                apply_memory_budget();
+            }
+            return true;
+        }
+
+        std::lock_guard lock(splitLocks_[split].mutex);
+        migrateCursor_ = shards_[split]->migrate_step(
+            migrateCursor_, kv::config::RESHARD_SLICE_KEYS,
+            [mod = 2 * base, target](size_t h) { return h % mod == target; }, *shards_[target]);
+        if (migrateCursor_ != 0) {
+            return true;
+        }
+        // Шард разделён. После последнего шарда круга base удваивается — маршрут ключей от этого
+        // не меняется: hash % base < split = base для всех ключей, то есть везде hash % (2 * base).
+        routing_.store(split + 1 == base ? encode_routing(2 * base, 0, false) : encode_routing(base, split + 1, false),
+                       std::memory_order_release);
+        return target + 1 < targetShards_;
+    }
+
+    // Делит бюджет памяти между созданными шардами. Под reshardMutex_.
+    void apply_memory_budget()
+        requires kSupportsEviction
+    {
+        size_t count = shard_count();
+        size_t perShard = maxMemory_ == 0 ? 0 : std::max<size_t>(maxMemory_ / count, 1);
+        for (size_t s = 0; s < count; ++s) {
+            shards_[s]->set_max_memory(perShard, policy_);
+        }
+    }
+
+    // Раскладывает ключи по шардам маршрутизации state (сортировка подсчётом, порядок внутри шарда
+    // сохраняется) и вызывает fn(s, slots) для каждого непустого шарда из owner. Ключ, который
+    // сейчас переносится, попадает в группу шарда-источника.
+    template <typename K, typename Fn>
+    void for_each_shard_group(std::span<const K> keys, std::uint64_t state, ShardOwner owner, Fn&& fn) const {
+        size_t count = routing_base(state) + routing_split(state) + ((state & kSplitting) ? 1 : 0);
+        std::vector<BatchSlot> hashed(keys.size());
+        std::vector<size_t> shardOf(keys.size());
+        std::vector<size_t> offsets(count + 1, 0);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t h = hash_(keys[i]);
+            hashed[i] = BatchSlot{h, i};
+            shardOf[i] = route(state, h).shard;
+            ++offsets[shardOf[i] + 1];
+        }
+        for (size_t s = 0; s < count; ++s) {
+            offsets[s + 1] += offsets[s];
+        }
+
+        std::vector<BatchSlot> grouped(keys.size());
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (const BatchSlot& slot : hashed) {
+            grouped[fill[shardOf[slot.index]]++] = slot;
+        }
+
+        for (size_t s = 0; s < count; ++s) {
+            if (offsets[s + 1] > offsets[s] && owner.owns(s)) {
+                fn(s, std::span<const BatchSlot>(grouped.data() + offsets[s], offsets[s + 1] - offsets[s]));
+            }
+        }
+    }
+
+    size_t maxShards_;
+    std::unique_ptr<std::unique_ptr<Table>[]> shards_;  // создаются по мере разделения, не удаляются
+    std::unique_ptr<SplitLock[]> splitLocks_;
+    std::atomic<std::uint64_t> routing_;
     Hash hash_;
+
+    // Состояние фонового разделения и бюджет памяти — под reshardMutex_.
+    mutable std::mutex reshardMutex_;
+    size_t targetShards_;
+    std::uint64_t migrateCursor_ = 0;
+    bool singleWriter_ = false;
+    size_t maxMemory_ = 0;
+    kv::config::EvictionPolicy policy_ = kv::config::EVICTION_POLICY;
 };
 
 }  // namespace kv
@@ -0,0 +1,67 @@
+// файл: include/kv/spsc_queue.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "kv/hash_utils.hpp"
+
+namespace kv {
+
+/*
+    Ограниченная очередь без блокировок для ровно одного писателя и одного читателя
+    (кольцевой буфер, ёмкость — степень двойки).
+
+    head_ двигает только читатель, tail_ — только писатель; каждый держит у себя кэш
+    чужого индекса и перечитывает его, лишь когда очередь кажется пустой (полной), так
+    что в установившемся режиме push/pop не трогают чужую кэш-линию.
+*/
+template <typename T>
+class SpscQueue {
+   public:
+    explicit SpscQueue(size_t capacity) : slots_(round_up_pow2(capacity > 1 ? capacity : 2)), mask_(slots_.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Только поток-писатель. false — очередь полна.
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ == slots_.size()) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ == slots_.size()) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только поток-читатель. false — очередь пуста.
+    bool pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) {
+                return false;
+            }
+        }
+        item = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    std::vector<T> slots_;
+    size_t mask_;
+
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tailCache_ = 0;  // кэш tail_ у читателя
+
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t headCache_ = 0;  // кэш head_ у писателя
+};
+
+}  // namespace kv
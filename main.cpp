@@ -29,6 +29,63 @@ int main(int argc, char* argv[]) {
 
     LOG_INFO("LaunchKV server on 0.0.0.0:5555");
     kv::Server<std::string, std::string> server("0.0.0.0", 5555);
+
+    // Необязательно: бюджет памяти в мегабайтах и политика вытеснения (lru | lfu).
+    if (argc >= 3) {
+        try {
+            size_t megabytes = std::stoull(argv[2]);
+            auto policy = kv::config::EVICTION_POLICY;
+            if (argc >= 4) {
+                std::string name = argv[3];
+                policy = name == "lfu" ? kv::config::EvictionPolicy::LFU : kv::config::EvictionPolicy::LRU;
+            }
+            server.set_max_memory(megabytes * 1024 * 1024, policy);
+            LOG_INFO("maxmemory: " + std::to_string(megabytes) + " MB");
+        } catch (...) {
+            std::cerr << "Неверный maxmemory: " << argv[2] << ", ограничение памяти не задано\n";
+        }
+    }
+
+    // Необязательно: число потоков-ядер (режим ядро-на-поток, шарды делятся между ядрами).
+    if (argc >= 5) {
+        try {
+            server.set_core_threads(std::stoul(argv[4]));
+        } catch (...) {
+            std::cerr << "Неверное число ядер: " << argv[4] << ", используется " << kv::config::CORE_THREADS << "\n";
+        }
+    }
+
+    // Необязательно: доля процессорного времени ядра на активную дефрагментацию (%, 0 — выключена).
+    if (argc >= 6) {
+        try {
+            server.set_defrag_cpu_percent(std::stoul(argv[5]));
+        } catch (...) {
+            std::cerr << "Неверная доля дефрагментации: " << argv[5] << ", используется "
+                      << kv::config::DEFRAG_CPU_PERCENT << "%\n";
+        }
+    }
+
+    // Необязательно: число потоков ввода-вывода в режиме без ядер (шарды общие).
+    if (argc >= 7) {
+        try {
+            server.set_io_threads(std::stoul(argv[6]));
+        } catch (...) {
+            std::cerr << "Неверное число потоков ввода-вывода: " << argv[6] << ", используется "
+                      << kv::config::IO_THREADS << "\n";
+        }
+    }
+
+    // Необязательно: механизм ввода-вывода циклов событий (epoll | io_uring).
+    if (argc >= 8) {
+        std::string name = argv[7];
+        if (name == "epoll" || name == "io_uring") {
+            kv::EventLoop::prefer_backend(name == "epoll" ? kv::IoBackend::Epoll : kv::IoBackend::IoUring);
+        } else {
+            std::cerr << "Неверный механизм ввода-вывода: " << argv[7] << ", используется "
+                      << (kv::config::IO_URING ? "io_uring" : "epoll") << "\n";
+        }
+    }
+
     server.run();
     pool.shutdown();
 
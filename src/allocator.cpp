@@ -1,56 +1,629 @@
 #include "kv/allocator.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
 namespace kv {
 
-MemoryPool::MemoryPool(size_t blockSize, size_t blocksCount) : blockSize_(blockSize),
-                                                               blocksCount_(blocksCount),
-                                                               freeList_(nullptr) {
-    assert(blockSize_ >= sizeof(FreeNode));
+namespace {
+
+// Номера потоков для магазинов MemoryPool: общие для всех пулов, освобождаются при завершении потока.
+std::array<std::atomic<bool>, kv::config::POOL_MAGAZINE_THREADS> magazineSlots{};
+
+constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+// Заголовок арены MemoryPool занимает первую кэш-линию, ячейки идут за ним.
+constexpr size_t kArenaHeader = 64;
+static_assert(std::has_single_bit(kv::config::POOL_ARENA_BYTES), "POOL_ARENA_BYTES must be a power of two");
+
+// bytes байт, выровненные по bytes (степень двойки); nullptr — система не дала памяти.
+void* map_aligned(size_t bytes) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, bytes);
+#else
+    // Берём вдвое больше и обрезаем края до выровненного куска.
+    void* raw = ::mmap(nullptr, 2 * bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    auto start = reinterpret_cast<std::uintptr_t>(raw);
+    std::uintptr_t aligned = (start + bytes - 1) & ~(bytes - 1);
+    if (aligned > start) {
+        ::munmap(raw, aligned - start);
+    }
+    if (std::uintptr_t tail = start + 2 * bytes - (aligned + bytes)) {
+        ::munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+#ifdef MADV_HUGEPAGE
+    if constexpr (kv::config::POOL_HUGE_PAGES) {
+        ::madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return reinterpret_cast<void*>(aligned);
+#endif
+}
+
+void unmap_aligned(void* ptr, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    _aligned_free(ptr);
+#else
+    ::munmap(ptr, bytes);
+#endif
+}
+
+// Отдаёт системе физические страницы, оставляя адреса за процессом (при следующем касании — нули).
+void discard_pages(void* ptr, size_t bytes) {
+#if defined(MADV_DONTNEED) && !defined(_WIN32)
+    ::madvise(ptr, bytes, MADV_DONTNEED);
+#else
+    (void)ptr;
+    (void)bytes;
+#endif
+}
+
+// Классы SlabAllocator: 16..128 с шагом 16, затем по четыре на удвоение до SLAB_MAX_SIZE.
+constexpr size_t kSmallStep = 16;
+constexpr size_t kSmallMax = 128;
+constexpr size_t kSmallClasses = kSmallMax / kSmallStep;
+constexpr size_t kClassesPerDoubling = 4;
+constexpr size_t kSmallMaxLog = 7;  // log2(kSmallMax)
+
+static_assert(std::has_single_bit(kv::config::SLAB_MAX_SIZE) && kv::config::SLAB_MAX_SIZE > kSmallMax,
+              "SLAB_MAX_SIZE must be a power of two above 128");
+constexpr size_t kClassCount =
+    kSmallClasses + (std::bit_width(kv::config::SLAB_MAX_SIZE) - 1 - kSmallMaxLog) * kClassesPerDoubling;
+
+// Пулы с магазинами: завершающийся поток обходит их, чтобы вернуть ячейки своих магазинов.
+// Не разрушается при выходе, как и SlabAllocator: потоки могут завершаться позже.
+struct PoolRegistry {
+    std::mutex mtx;
+    std::vector<MemoryPool*> pools;
+};
+
+PoolRegistry& pool_registry() {
+    static PoolRegistry* registry = new PoolRegistry();
+    return *registry;
+}
+
+// Без деструктора: состояние остаётся читаемым из thread_local-деструкторов, которые
+// освобождают ячейки уже после MagazineThreadExit.
+struct MagazineThreadState {
+    size_t slot = kNoSlot;
+    bool assigned = false;
+};
+
+thread_local constinit MagazineThreadState tlsMagazine;
+
+}  // namespace
+
+// Деструктор срабатывает при завершении потока, получившего номер: магазины потока во всех пулах
+// сбрасываются в арены, и лишь затем номер освобождается. assigned остаётся true, поэтому
+// дальнейшие allocate/deallocate этого потока идут под mtx_ и не трогают магазин, который уже
+// может принадлежать новому потоку.
+struct MagazineThreadExit {
+    ~MagazineThreadExit() {
+        MagazineThreadState& st = tlsMagazine;
+        size_t slot = st.slot;
+        if (slot == kNoSlot) {
+            return;
+        }
+        st.slot = kNoSlot;
+        {
+            PoolRegistry& registry = pool_registry();
+            std::lock_guard<std::mutex> lock(registry.mtx);
+            for (MemoryPool* pool : registry.pools) {
+                pool->flush_magazine(slot);
+            }
+        }
+        magazineSlots[slot].store(false, std::memory_order_release);
+    }
+};
+
+namespace {
+
+thread_local MagazineThreadExit tlsMagazineExit;
+
+// Номер текущего потока; kNoSlot — все номера заняты или поток уже завершается, с пулами он
+// работает под мьютексом.
+size_t magazine_slot() {
+    MagazineThreadState& st = tlsMagazine;
+    if (!st.assigned) {
+        st.assigned = true;
+        for (size_t i = 0; i < magazineSlots.size(); ++i) {
+            bool expected = false;
+            if (!magazineSlots[i].load(std::memory_order_relaxed) &&
+                magazineSlots[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                st.slot = i;
+                (void)&tlsMagazineExit;  // обращение создаёт объект и регистрирует его деструктор
+                break;
+            }
+        }
+    }
+    return st.slot;
+}
+
+}  // namespace
+
+MemoryPool::MemoryPool(size_t blockSize, size_t magazineSize)
+    : blockSize_(blockSize),
+      magazineSize_(magazineSize),
+      cellsPerArena_((kv::config::POOL_ARENA_BYTES - kArenaHeader) / blockSize) {
+    static_assert(sizeof(Arena) <= kArenaHeader, "arena header must fit its reserved cache line");
+    assert(blockSize_ >= sizeof(FreeNode) && cellsPerArena_ > 0);
+    if (magazineSize_ != 0) {
+        PoolRegistry& registry = pool_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.pools.push_back(this);
+    }
 }
 MemoryPool::~MemoryPool() {
-    for (size_t i = 0; i < allBlocks_.size(); ++i) {
-        std::free(allBlocks_[i]);
+    if (magazineSize_ != 0) {
+        PoolRegistry& registry = pool_registry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.pools.erase(std::find(registry.pools.begin(), registry.pools.end(), this));
+    }
+    delete[] magazines_.load(std::memory_order_relaxed);
+    for (ArenaList* list : {&available_, &full_, &draining_}) {
+        while (Arena* arena = list->head) {
+            list->remove(arena);
+            unmap_aligned(arena, kv::config::POOL_ARENA_BYTES);
+        }
     }
-    freeList_ = nullptr;
 }
 
-void MemoryPool::allocateBlock() {
-    size_t totalSize = blockSize_ * blocksCount_;
-    void* block = std::malloc(totalSize);
+void MemoryPool::ArenaList::push_front(Arena* arena) {
+    arena->prev = nullptr;
+    arena->next = head;
+    (head ? head->prev : tail) = arena;
+    head = arena;
+}
+
+void MemoryPool::ArenaList::push_back(Arena* arena) {
+    arena->next = nullptr;
+    arena->prev = tail;
+    (tail ? tail->next : head) = arena;
+    tail = arena;
+}
+
+void MemoryPool::ArenaList::remove(Arena* arena) {
+    (arena->prev ? arena->prev->next : head) = arena->next;
+    (arena->next ? arena->next->prev : tail) = arena->prev;
+}
 
-    if (block == nullptr)
+MemoryPool::Arena* MemoryPool::arena_of(const void* ptr) {
+    return reinterpret_cast<Arena*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(kv::config::POOL_ARENA_BYTES - 1));
+}
+
+MemoryPool::Arena* MemoryPool::map_arena() {
+    void* mem = map_aligned(kv::config::POOL_ARENA_BYTES);
+    if (mem == nullptr)
         throw std::bad_alloc();
 
-    allBlocks_.push_back(block);
+    auto* arena = new (mem) Arena{nullptr, nullptr, nullptr, 0, 0, false, false};
+    available_.push_front(arena);
+    reservedBytes_.fetch_add(kv::config::POOL_ARENA_BYTES, std::memory_order_relaxed);
+    freeCount_.fetch_add(cellsPerArena_, std::memory_order_relaxed);
+    return arena;
+}
 
-    char* ptr = static_cast<char*>(block);
-    for (size_t i = 0; i < blocksCount_; ++i) {
-        FreeNode* node = reinterpret_cast<FreeNode*>(ptr + i * blockSize_);
-        node->next = freeList_;
-        freeList_ = node;
+// Ячейка из первой арены со свободным местом: сначала возвращённые, потом ещё не нарезанные.
+void* MemoryPool::take_cell() {
+    Arena* arena = available_.head ? available_.head : map_arena();
+    FreeNode* node = arena->freeList;
+    if (node) {
+        arena->freeList = node->next;
+        --arena->freeCount;
+        holeCount_.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+        node = reinterpret_cast<FreeNode*>(reinterpret_cast<char*>(arena) + kArenaHeader + arena->carved * blockSize_);
+        ++arena->carved;
     }
+    if (arena_full(arena)) {
+        available_.remove(arena);
+        full_.push_front(arena);
+    }
+    freeCount_.fetch_sub(1, std::memory_order_relaxed);
+    return node;
 }
 
-void* MemoryPool::allocate() {
+// Возвращает ячейку её арене. Опустевшая арена уходит в конец списка, чтобы её не занимали снова.
+void MemoryPool::put_cell(FreeNode* node) {
+    Arena* arena = arena_of(node);
+    bool wasFull = arena_full(arena);
+    node->next = arena->freeList;
+    arena->freeList = node;
+    ++arena->freeCount;
+    holeCount_.fetch_add(1, std::memory_order_relaxed);
+    freeCount_.fetch_add(1, std::memory_order_relaxed);
+    if (arena->drained && arena_empty(arena)) {
+        // Осушенная арена опустела: дефрагментация своё сделала, дальше её заберёт trim().
+        arena->drained = false;
+        reclaimedBytes_.fetch_add(kv::config::POOL_ARENA_BYTES, std::memory_order_relaxed);
+    }
+    if (arena->draining.load(std::memory_order_relaxed)) {
+        if (arena_empty(arena)) {
+            draining_.remove(arena);
+            arena->draining.store(false, std::memory_order_relaxed);
+            drainingCount_.fetch_sub(1, std::memory_order_relaxed);
+            available_.push_back(arena);
+        }
+        return;
+    }
+    if (wasFull) {
+        full_.remove(arena);
+    } else if (arena_empty(arena)) {
+        available_.remove(arena);
+    }
+    if (arena_empty(arena)) {
+        available_.push_back(arena);
+    } else if (wasFull) {
+        available_.push_front(arena);
+    }
+}
+
+size_t MemoryPool::trim() {
+    std::vector<Arena*> unmapped;
+    Arena* spare = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        bool keepSpare = true;
+        for (Arena* arena = available_.head; arena;) {
+            Arena* next = arena->next;
+            if (arena_empty(arena)) {
+                if (keepSpare && arena->carved == 0) {
+                    keepSpare = false;  // запасная арена, страницы которой и так не тронуты
+                } else {
+                    available_.remove(arena);
+                    holeCount_.fetch_sub(arena->freeCount, std::memory_order_relaxed);
+                    unmapped.push_back(arena);
+                }
+            }
+            arena = next;
+        }
+        // Запасной оставляем одну опустевшую арену: её страницы сбрасываются, а адреса остаются.
+        if (keepSpare && !unmapped.empty()) {
+            spare = unmapped.back();
+            unmapped.pop_back();
+        }
+        reservedBytes_.fetch_sub(unmapped.size() * kv::config::POOL_ARENA_BYTES, std::memory_order_relaxed);
+        freeCount_.fetch_sub((unmapped.size() + (spare ? 1 : 0)) * cellsPerArena_, std::memory_order_relaxed);
+    }
+
+    for (Arena* arena : unmapped) {
+        unmap_aligned(arena, kv::config::POOL_ARENA_BYTES);
+    }
+    if (spare) {
+        discard_pages(spare, kv::config::POOL_ARENA_BYTES);
+        std::lock_guard<std::mutex> lock(mtx_);
+        new (spare) Arena{nullptr, nullptr, nullptr, 0, 0, false, false};
+        available_.push_back(spare);
+        freeCount_.fetch_add(cellsPerArena_, std::memory_order_relaxed);
+    }
+    return (unmapped.size() + (spare ? 1 : 0)) * kv::config::POOL_ARENA_BYTES;
+}
+
+bool MemoryPool::fragmented() const {
+    size_t holes = holeCount_.load(std::memory_order_relaxed);
+    size_t cells = reservedBytes_.load(std::memory_order_relaxed) / kv::config::POOL_ARENA_BYTES * cellsPerArena_;
+    return holes >= cellsPerArena_ && holes * 100 >= cells * kv::config::DEFRAG_THRESHOLD_PERCENT;
+}
+
+bool MemoryPool::should_relocate(const void* ptr) {
+    if (!fragmented()) {
+        return false;
+    }
     std::lock_guard<std::mutex> lock(mtx_);
-    if (!freeList_) {
-        allocateBlock();
+    Arena* arena = arena_of(ptr);
+    if (arena->draining.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (!arena_sparse(arena)) {
+        return false;
     }
+    drain_arena(arena);
+    return true;
+}
 
-    FreeNode* node = freeList_;
-    freeList_ = freeList_->next;
-    return node;
+// Разреженная арена: в деле есть ячейки, но их меньше, чем дыр, и меньше DEFRAG_ARENA_FILL_PERCENT.
+bool MemoryPool::arena_sparse(const Arena* arena) const {
+    size_t live = arena->carved - arena->freeCount;
+    return live != 0 && live < arena->freeCount && live * 100 < cellsPerArena_ * kv::config::DEFRAG_ARENA_FILL_PERCENT;
+}
+
+// Арена с дырами лежит в available_.
+void MemoryPool::drain_arena(Arena* arena) {
+    available_.remove(arena);
+    draining_.push_front(arena);
+    arena->draining.store(true, std::memory_order_relaxed);
+    arena->drained = true;
+    drainingCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Перенесённая ячейка не должна попасть в другую разреженную арену: такие арены из головы списка
+// осушаются сразу, иначе узел, уже пройденный дефрагментацией, застрял бы в них.
+void* MemoryPool::allocate_dense() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    while (available_.head && arena_sparse(available_.head)) {
+        drain_arena(available_.head);
+    }
+    movedCells_.fetch_add(1, std::memory_order_relaxed);
+    return take_cell();
+}
+
+// Арены, которые так и не опустели, снова выдают ячейки, но после прочих: их последние ячейки
+// могут ещё ждать отложенного освобождения.
+// Магазин текущего потока (того, что переносил узлы) сначала возвращает свои ячейки: среди
+// них могут быть последние ячейки осушаемых арен, освобождённые до начала переноса.
+void MemoryPool::end_defrag() {
+    flush_magazine();
+    std::lock_guard<std::mutex> lock(mtx_);
+    while (Arena* arena = draining_.head) {
+        draining_.remove(arena);
+        arena->draining.store(false, std::memory_order_relaxed);
+        drainingCount_.fetch_sub(1, std::memory_order_relaxed);
+        available_.push_back(arena);
+    }
+}
+
+DefragStats MemoryPool::defrag_stats() const {
+    size_t moved = movedCells_.load(std::memory_order_relaxed);
+    return {moved, moved * blockSize_, reclaimedBytes_.load(std::memory_order_relaxed)};
+}
+
+MemoryPool::Magazine* MemoryPool::magazine() {
+    if (magazineSize_ == 0) {
+        return nullptr;
+    }
+    size_t slot = magazine_slot();
+    if (slot == kNoSlot) {
+        return nullptr;
+    }
+    Magazine* mags = magazines_.load(std::memory_order_acquire);
+    if (!mags) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        mags = magazines_.load(std::memory_order_relaxed);
+        if (!mags) {
+            mags = new Magazine[kv::config::POOL_MAGAZINE_THREADS];
+            magazines_.store(mags, std::memory_order_release);
+        }
+    }
+    return &mags[slot];
+}
+
+// Пустой магазин берёт из арен половину своей ёмкости.
+void MemoryPool::refill(Magazine& mag) {
+    size_t want = magazineSize_ > 1 ? magazineSize_ / 2 : 1;
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < want; ++i) {
+        auto* node = static_cast<FreeNode*>(take_cell());
+        node->next = mag.head;
+        mag.head = node;
+    }
+    mag.count.store(mag.count.load(std::memory_order_relaxed) + want, std::memory_order_relaxed);
+}
+
+// Возвращает n ячеек из головы магазина их аренам.
+void MemoryPool::flush(Magazine& mag, size_t n) {
+    FreeNode* node = mag.head;
+    FreeNode* last = node;
+    for (size_t i = 1; i < n; ++i) {
+        last = last->next;
+    }
+    mag.head = last->next;
+    last->next = nullptr;
+    mag.count.store(mag.count.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    while (node) {
+        FreeNode* next = node->next;
+        put_cell(node);
+        node = next;
+    }
+}
+
+void MemoryPool::flush_magazine() {
+    if (Magazine* mag = magazine()) {
+        if (size_t count = mag->count.load(std::memory_order_relaxed)) {
+            flush(*mag, count);
+        }
+    }
+}
+
+void MemoryPool::flush_magazine(size_t slot) {
+    if (Magazine* mags = magazines_.load(std::memory_order_acquire)) {
+        if (size_t count = mags[slot].count.load(std::memory_order_relaxed)) {
+            flush(mags[slot], count);
+        }
+    }
+}
+
+void* MemoryPool::allocate() {
+    if (Magazine* mag = magazine()) {
+        if (!mag->head) {
+            refill(*mag);
+        }
+        FreeNode* node = mag->head;
+        mag->head = node->next;
+        mag->count.store(mag->count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return node;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    return take_cell();
 }
 
 void MemoryPool::deallocate(void* ptr) {
     if (!ptr) return;
-    std::lock_guard<std::mutex> lock(mtx_);
     FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
-    node->next = freeList_;
-    freeList_ = node;
+    // Ячейку осушаемой арены магазин не берёт: иначе она снова уйдёт в дело и арена не опустеет.
+    bool draining = drainingCount_.load(std::memory_order_relaxed) != 0 &&
+                    arena_of(ptr)->draining.load(std::memory_order_relaxed);
+    Magazine* mag = draining ? nullptr : magazine();
+    if (mag) {
+        size_t count = mag->count.load(std::memory_order_relaxed);
+        if (count >= magazineSize_) {
+            flush(*mag, count - magazineSize_ / 2);
+        }
+        node->next = mag->head;
+        mag->head = node;
+        mag->count.store(mag->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    put_cell(node);
+}
+
+size_t MemoryPool::free_bytes() const {
+    size_t count = freeCount_.load(std::memory_order_relaxed);
+    if (const Magazine* mags = magazines_.load(std::memory_order_acquire)) {
+        for (size_t i = 0; i < kv::config::POOL_MAGAZINE_THREADS; ++i) {
+            count += mags[i].count.load(std::memory_order_relaxed);
+        }
+    }
+    return count * blockSize_;
+}
+
+SlabAllocator& SlabAllocator::instance() {
+    // Не разрушается при выходе: узлы статических таблиц могут освобождаться позже.
+    static SlabAllocator* slab = new SlabAllocator();
+    return *slab;
+}
+
+SlabAllocator::SlabAllocator() : classes_(new SizeClass[kClassCount]) {
+    for (size_t i = 0; i < kClassCount; ++i) {
+        // Магазины крупных классов короче: поток не должен держать у себя мегабайты свободных ячеек.
+        size_t cell = class_size(i);
+        size_t magazine = std::clamp<size_t>(kv::config::SLAB_MAGAZINE_BYTES / cell,
+                                             std::min<size_t>(2, kv::config::POOL_MAGAZINE_SIZE),
+                                             kv::config::POOL_MAGAZINE_SIZE);
+        classes_[i].pool = std::make_unique<MemoryPool>(cell, magazine);
+    }
+}
+
+size_t SlabAllocator::class_index(size_t size) {
+    if (size <= kSmallMax) {
+        return size == 0 ? 0 : (size - 1) / kSmallStep;
+    }
+    // size в (2^k, 2^(k+1)]: четыре класса с шагом 2^(k-2).
+    size_t n = size - 1;
+    size_t k = static_cast<size_t>(std::bit_width(n)) - 1;
+    return kSmallClasses + (k - kSmallMaxLog) * kClassesPerDoubling + ((n >> (k - 2)) - kClassesPerDoubling);
+}
+
+size_t SlabAllocator::class_size(size_t index) {
+    if (index < kSmallClasses) {
+        return (index + 1) * kSmallStep;
+    }
+    size_t k = kSmallMaxLog + (index - kSmallClasses) / kClassesPerDoubling;
+    size_t sub = (index - kSmallClasses) % kClassesPerDoubling;
+    return (size_t{1} << k) + (sub + 1) * (size_t{1} << (k - 2));
+}
+
+size_t SlabAllocator::allocation_size(size_t size) {
+    return size > kv::config::SLAB_MAX_SIZE ? size : class_size(class_index(size));
+}
+
+void* SlabAllocator::allocate(size_t size) {
+    if (size > kv::config::SLAB_MAX_SIZE) {
+        largeCount_.fetch_add(1, std::memory_order_relaxed);
+        largeBytes_.fetch_add(size, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+    SizeClass& cls = classes_[class_index(size)];
+    void* ptr = cls.pool->allocate();
+    cls.requestedBytes.fetch_add(size, std::memory_order_relaxed);
+    return ptr;
+}
+
+void SlabAllocator::deallocate(void* ptr, size_t size) {
+    if (size > kv::config::SLAB_MAX_SIZE) {
+        largeCount_.fetch_sub(1, std::memory_order_relaxed);
+        largeBytes_.fetch_sub(size, std::memory_order_relaxed);
+        ::operator delete(ptr);
+        return;
+    }
+    SizeClass& cls = classes_[class_index(size)];
+    cls.requestedBytes.fetch_sub(size, std::memory_order_relaxed);
+    cls.pool->deallocate(ptr);
+}
+
+size_t SlabAllocator::trim() {
+    size_t released = 0;
+    for (size_t i = 0; i < kClassCount; ++i) {
+        released += classes_[i].pool->trim();
+    }
+    return released;
+}
+
+bool SlabAllocator::fragmented() const {
+    for (size_t i = 0; i < kClassCount; ++i) {
+        if (classes_[i].pool->fragmented()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SlabAllocator::should_relocate(const void* ptr, size_t size) {
+    return size <= kv::config::SLAB_MAX_SIZE && classes_[class_index(size)].pool->should_relocate(ptr);
+}
+
+void* SlabAllocator::allocate_dense(size_t size) {
+    assert(size <= kv::config::SLAB_MAX_SIZE);
+    SizeClass& cls = classes_[class_index(size)];
+    void* ptr = cls.pool->allocate_dense();
+    cls.requestedBytes.fetch_add(size, std::memory_order_relaxed);
+    return ptr;
+}
+
+void SlabAllocator::flush_magazines() {
+    for (size_t i = 0; i < kClassCount; ++i) {
+        classes_[i].pool->flush_magazine();
+    }
+}
+
+void SlabAllocator::end_defrag() {
+    for (size_t i = 0; i < kClassCount; ++i) {
+        classes_[i].pool->end_defrag();
+    }
+}
+
+DefragStats SlabAllocator::defrag_stats() const {
+    DefragStats total;
+    for (size_t i = 0; i < kClassCount; ++i) {
+        total += classes_[i].pool->defrag_stats();
+    }
+    return total;
+}
+
+std::vector<SlabAllocator::ClassStats> SlabAllocator::stats() const {
+    std::vector<ClassStats> out;
+    for (size_t i = 0; i < kClassCount; ++i) {
+        const MemoryPool& pool = *classes_[i].pool;
+        size_t reserved = pool.reserved_bytes();
+        if (reserved == 0) {
+            continue;
+        }
+        // Счётчики читаются не атомарно вместе — свободных может на миг оказаться больше выданных.
+        size_t free = std::min(pool.free_bytes(), reserved);
+        out.push_back(ClassStats{pool.block_size(), (reserved - free) / pool.block_size(),
+                                 classes_[i].requestedBytes.load(std::memory_order_relaxed), reserved, free});
+    }
+    size_t largeBytes = largeBytes_.load(std::memory_order_relaxed);
+    out.push_back(ClassStats{0, largeCount_.load(std::memory_order_relaxed), largeBytes, largeBytes, 0});
+    return out;
 }
 
-}  // namespace kv
\ No newline at end of file
+}  // namespace kv
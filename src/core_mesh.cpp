@@ -0,0 +1,55 @@
+#include "kv/core_mesh.hpp"
+
+#include "config.hpp"
+
+namespace kv {
+
+namespace {
+thread_local size_t tlsCore = CoreMesh::kNoCore;
+}
+
+CoreMesh::CoreMesh(size_t cores) : cores_(cores), inboxes_(new Inbox[cores]) {
+    queues_.reserve(cores_ * cores_);
+    for (size_t i = 0; i < cores_ * cores_; ++i) {
+        queues_.push_back(std::make_unique<SpscQueue<Message>>(kv::config::CORE_QUEUE_CAPACITY));
+    }
+}
+
+void CoreMesh::attach(size_t core) {
+    tlsCore = core;
+    inboxes_[core].loop = &EventLoop::instance();
+    inboxes_[core].loop->set_wakeup_handler([this, core] { drain(core); });
+}
+
+size_t CoreMesh::current() {
+    return tlsCore;
+}
+
+void CoreMesh::post(size_t to, Message msg) {
+    size_t from = tlsCore;
+    SpscQueue<Message>& q = queue(from, to);
+    while (!q.push(msg)) {
+        // Очередь полна: получатель не успевает. Ядро тем временем разбирает свои входящие,
+        // иначе два ядра с полными встречными очередями ждали бы друг друга вечно.
+        drain(from);
+    }
+    // Обмен с drain() по одной переменной: либо получатель увидит сообщение в текущем
+    // проходе, либо мы увидим сброшенный флаг и разбудим его.
+    Inbox& inbox = inboxes_[to];
+    if (!inbox.pending.exchange(true, std::memory_order_acq_rel)) {
+        inbox.loop->wakeup();
+    }
+}
+
+void CoreMesh::drain(size_t core) {
+    inboxes_[core].pending.exchange(false, std::memory_order_acq_rel);
+    Message msg;
+    for (size_t from = 0; from < cores_; ++from) {
+        SpscQueue<Message>& q = queue(from, core);
+        while (q.pop(msg)) {
+            msg.fn(msg.ctx, msg.arg);
+        }
+    }
+}
+
+}  // namespace kv
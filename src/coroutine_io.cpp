@@ -1,5 +1,7 @@
 #include "kv/coroutine_io.hpp"
 
+#include "config.hpp"
+#include "kv/io_uring.hpp"
 #include "kv/logger.hpp"
 
 #ifdef _WIN32
@@ -9,16 +11,60 @@
 #else
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 namespace kv {
 
+namespace {
+
+std::atomic<IoBackend> preferredBackend{kv::config::IO_URING ? IoBackend::IoUring : IoBackend::Epoll};
+
+}  // namespace
+
+void EventLoop::prefer_backend(IoBackend backend) {
+    preferredBackend.store(backend, std::memory_order_relaxed);
+}
+
+void EventLoop::stop() {
+    stopped_.store(true, std::memory_order_relaxed);
+    wakeup();
+}
+
+void EventLoop::add_timer(std::chrono::milliseconds interval, std::function<void()> fn) {
+    timers_.push_back(Timer{std::chrono::steady_clock::now() + interval, interval, std::move(fn)});
+}
+
+int EventLoop::run_due_timers() {
+    if (timers_.empty()) {
+        return -1;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto nearest = std::chrono::steady_clock::time_point::max();
+    for (auto& timer : timers_) {
+        if (timer.due <= now) {
+            timer.fn();
+            // Отсчёт от текущего момента: долгий обработчик не вызывает серию запусков подряд.
+            timer.due = now + timer.interval;
+        }
+        nearest = std::min(nearest, timer.due);
+    }
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(nearest - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<std::chrono::milliseconds::rep>(wait.count(), 0));
+}
+
 #ifdef _WIN32
 
 EventLoop::EventLoop() {
@@ -37,7 +83,7 @@ EventLoop::~EventLoop() {
 }
 
 EventLoop& EventLoop::instance() {
-    static EventLoop loop;
+    thread_local EventLoop loop;
     return loop;
 }
 
@@ -59,12 +105,29 @@ void EventLoop::remove(SOCKET_TYPE fd) {
     LOG_DEBUG(std::string("Closesocket fd=") + std::to_string(fd));
 }
 
+// Без eventfd: пока обработчик задан, select ждёт не дольше 1 мс и onWake_ опрашивается каждый проход.
+void EventLoop::set_wakeup_handler(std::function<void()> onWake) {
+    onWake_ = std::move(onWake);
+}
+
+void EventLoop::wakeup() {}
+
+std::uint64_t EventLoop::syscalls() const {
+    return syscalls_;
+}
+
 void EventLoop::run() {
     wait_and_handle_select();
 }
 
 void EventLoop::wait_and_handle_select() {
-    while (true) {
+    while (!stopped_.load(std::memory_order_relaxed)) {
+        int timeoutMs = run_due_timers();
+        if (onWake_) {
+            onWake_();
+            timeoutMs = timeoutMs < 0 ? 1 : std::min(timeoutMs, 1);
+        }
+
         fd_set readSet, writeSet;
         FD_ZERO(&readSet);
         FD_ZERO(&writeSet);
@@ -88,7 +151,9 @@ void EventLoop::wait_and_handle_select() {
         }
 
         // Блокируем до тех пор, пока какой-нибудь сокет не станет готов
-        int readyCount = select(0, &readSet, &writeSet, nullptr, nullptr);
+        timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        ++syscalls_;
+        int readyCount = select(0, &readSet, &writeSet, nullptr, timeoutMs < 0 ? nullptr : &timeout);
         if (readyCount == SOCKET_ERROR) {
             int err = WSAGetLastError();
             LOG_ERROR(std::string("select() failed: ") + std::to_string(err));
@@ -132,11 +197,21 @@ void EventLoop::wait_and_handle_select() {
     }
 }
 
-void ReadAwaitable::await_suspend(std::coroutine_handle<> h) {
+bool io_would_block() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+bool ReadAwaitable::await_ready() {
+    return false;
+}
+
+bool ReadAwaitable::await_suspend(std::coroutine_handle<> h) {
     EventLoop::instance().add_reader(fd_, h);
+    return true;
 }
 
 ssize_t ReadAwaitable::await_resume() {
+    EventLoop::instance().count_syscall();
     int n = recv(fd_, buffer_, static_cast<int>(size_), 0);
     if (n < 0) {
         int err = WSAGetLastError();
@@ -151,11 +226,57 @@ ssize_t ReadAwaitable::await_resume() {
     return bytesRead_;
 }
 
-void WriteAwaitable::await_suspend(std::coroutine_handle<> h) {
+// Неблокирующий accept; соединение сразу переводится в неблокирующий режим.
+static SOCKET_TYPE try_accept(SOCKET_TYPE listenFd, int& error) {
+    EventLoop::instance().count_syscall();
+    SOCKET_TYPE socket = accept(listenFd, nullptr, nullptr);
+    if (socket == INVALID_SOCKET) {
+        error = WSAGetLastError();
+        return socket;
+    }
+    error = 0;
+    u_long nonBlocking = 1;
+    if (ioctlsocket(socket, FIONBIO, &nonBlocking) != 0) {
+        LOG_WARN(std::string("ioctlsocket(FIONBIO) failed: ") + std::to_string(WSAGetLastError()));
+    }
+    return socket;
+}
+
+bool AcceptAwaitable::await_ready() {
+    if (waitReady_) {
+        return false;
+    }
+    socket_ = try_accept(fd_, error_);
+    return socket_ != INVALID_SOCKET || error_ != WSAEWOULDBLOCK;
+}
+
+bool AcceptAwaitable::await_suspend(std::coroutine_handle<> h) {
+    suspended_ = true;
+    EventLoop::instance().add_reader(fd_, h);
+    return true;
+}
+
+SOCKET_TYPE AcceptAwaitable::await_resume() {
+    if (suspended_) {
+        socket_ = try_accept(fd_, error_);
+    }
+    if (socket_ == INVALID_SOCKET) {
+        WSASetLastError(error_);
+    }
+    return socket_;
+}
+
+bool WriteAwaitable::await_ready() {
+    return false;
+}
+
+bool WriteAwaitable::await_suspend(std::coroutine_handle<> h) {
     EventLoop::instance().add_writer(fd_, h);
+    return true;
 }
 
 ssize_t WriteAwaitable::await_resume() {
+    EventLoop::instance().count_syscall();
     int n = send(fd_, buffer_, static_cast<int>(size_), 0);
     if (n < 0) {
         int err = WSAGetLastError();
@@ -170,86 +291,298 @@ ssize_t WriteAwaitable::await_resume() {
     return bytesWritten_;
 }
 
+bool WritevAwaitable::await_ready() {
+    return false;
+}
+
+bool WritevAwaitable::await_suspend(std::coroutine_handle<> h) {
+    EventLoop::instance().add_writer(fd_, h);
+    return true;
+}
+
+ssize_t WritevAwaitable::await_resume() {
+    WSABUF bufs[MAX_IO_SLICES];
+    DWORD count = static_cast<DWORD>(std::min(count_, MAX_IO_SLICES));
+    for (DWORD i = 0; i < count; ++i) {
+        bufs[i].buf = const_cast<char*>(slices_[i].data);
+        bufs[i].len = static_cast<ULONG>(slices_[i].size);
+    }
+    DWORD sent = 0;
+    EventLoop::instance().count_syscall();
+    if (WSASend(fd_, bufs, count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+        if (err != WSAEWOULDBLOCK) {
+            LOG_WARN(std::string("WSASend() returned error on fd=") +
+                     std::to_string(fd_) + ": " + std::to_string(err));
+        }
+        bytesWritten_ = -1;
+    } else {
+        bytesWritten_ = static_cast<ssize_t>(sent);
+    }
+    return bytesWritten_;
+}
+
 #else
 
 EventLoop::EventLoop() {
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0) {
+        LOG_FATAL(std::string("eventfd() failed: ") + std::strerror(errno));
+    }
+    if (preferredBackend.load(std::memory_order_relaxed) == IoBackend::IoUring && init_uring()) {
+        backend_ = IoBackend::IoUring;
+        return;
+    }
+
     epollFd_ = epoll_create1(0);
     if (epollFd_ < 0) {
         LOG_FATAL(std::string("epoll_create1() failed: ") + std::strerror(errno));
     }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd_;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev) < 0) {
+        LOG_FATAL(std::string("epoll_ctl(ADD,eventfd) failed: ") + std::strerror(errno));
+    }
 }
 
 EventLoop::~EventLoop() {
-    close(epollFd_);
-    LOG_DEBUG("Closed epollFd_");
+    close(wakeFd_);
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+        LOG_DEBUG("Closed epollFd_");
+    }
 }
 
 EventLoop& EventLoop::instance() {
-    static EventLoop loop;
+    thread_local EventLoop loop;
     return loop;
 }
 
-void EventLoop::add_reader(int fd, std::coroutine_handle<> h) {
-    // переводим в non-blocking
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags < 0) {
-        LOG_ERROR(std::string("fcntl(F_GETFL) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
-        return;
+std::uint64_t EventLoop::syscalls() const {
+    return syscalls_ + (uring_ ? uring_->enters() : 0);
+}
+
+bool EventLoop::init_uring() {
+    uring_ = std::make_unique<IoUring>();
+    if (!uring_->init(kv::config::URING_ENTRIES)) {
+        LOG_WARN("io_uring is unavailable, falling back to epoll");
+        uring_.reset();
+        return false;
     }
-    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
-        LOG_ERROR(std::string("fcntl(F_SETFL,O_NONBLOCK) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
-        return;
+    uring_->setup_buffers(kv::config::URING_BUFFERS, kv::config::CONNECTION_BUFFER_SIZE);
+
+    // eventfd слушает постоянный multishot poll: wakeup() будит поток, ждущий в io_uring_enter.
+    wakeOp_.complete = &EventLoop::finish_wake;
+    wakeOp_.fd = wakeFd_;
+    wakeOp_.opcode = IORING_OP_POLL_ADD;
+    if (!submit(wakeOp_)) {
+        LOG_WARN("io_uring poll on eventfd failed, falling back to epoll");
+        uring_.reset();
+        return false;
     }
+    return true;
+}
 
-    epoll_event ev{};
-    ev.events = EPOLLIN | EPOLLET;
-    ev.data.fd = fd;
-    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
-        LOG_ERROR(std::string("epoll_ctl(ADD,EPOLLIN) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
+bool EventLoop::submit(IoOperation& op) {
+    if (!op.complete) {
+        op.complete = &EventLoop::finish_io;
+    }
+    io_uring_sqe* sqe = uring_->get_sqe();
+    if (!sqe) {
+        op.result = -EBUSY;
+        return false;
+    }
+    sqe->opcode = op.opcode;
+    sqe->fd = op.fd;
+    sqe->user_data = reinterpret_cast<std::uint64_t>(&op);
+    switch (op.opcode) {
+        case IORING_OP_RECV:
+            // Из кольца буферов: пока соединение ждёт данных, память под чтение не занята.
+            if (uring_->has_buffers() && !(op.flags & IoOperation::kDirect)) {
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = IoUring::kBufferGroup;
+                sqe->len = static_cast<std::uint32_t>(std::min(op.size, uring_->buffer_size()));
+            } else {
+                sqe->addr = reinterpret_cast<std::uint64_t>(op.data);
+                sqe->len = static_cast<std::uint32_t>(op.size);
+            }
+            break;
+        case IORING_OP_SEND:
+            sqe->addr = reinterpret_cast<std::uint64_t>(op.data);
+            sqe->len = static_cast<std::uint32_t>(op.size);
+            sqe->msg_flags = MSG_NOSIGNAL;
+            break;
+        case IORING_OP_SENDMSG:
+            sqe->addr = reinterpret_cast<std::uint64_t>(op.data);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            break;
+        case IORING_OP_ACCEPT:
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            if (op.flags & IoOperation::kMultishot) {
+                sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+            }
+            break;
+        case IORING_OP_POLL_ADD:
+            sqe->poll32_events = POLLIN;
+            sqe->len = IORING_POLL_ADD_MULTI;
+            break;
+        default:
+            break;
     }
+    if (op.flags & IoOperation::kPollFirst) {
+        sqe->ioprio |= IORING_RECVSEND_POLL_FIRST;
+    }
+    return true;
+}
 
-    std::lock_guard<std::mutex> lock(handlersMutex_);
-    handlers_[fd] = Handler{h, EPOLLIN};
-    LOG_TRACE(std::string("Registered fd=") + std::to_string(fd) + " for EPOLLIN");
+void EventLoop::finish_io(IoOperation& op, int res, std::uint32_t flags) {
+    EventLoop& loop = EventLoop::instance();
+    if (flags & IORING_CQE_F_BUFFER) {
+        unsigned id = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (res > 0) {
+            std::memcpy(op.data, loop.uring_->buffer(id), static_cast<size_t>(res));
+        }
+        loop.uring_->recycle(id);
+    }
+    // Кольцо буферов опустело — читаем прямо в буфер соединения. Сокет без данных (EAGAIN) —
+    // повторяем после готовности: такую операцию ядро ставит ждать, а не завершает сразу.
+    bool retry = false;
+    if (res == -ENOBUFS && !(op.flags & IoOperation::kDirect)) {
+        op.flags |= IoOperation::kDirect;
+        retry = true;
+    } else if (res == -EAGAIN && !(op.flags & IoOperation::kPollFirst)) {
+        op.flags |= IoOperation::kPollFirst;
+        retry = true;
+    }
+    if (retry) {
+        if (loop.submit(op)) {
+            return;
+        }
+        res = op.result;
+    }
+    op.result = res;
+    op.handle.resume();
 }
 
-void EventLoop::add_writer(int fd, std::coroutine_handle<> h) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags < 0) {
-        LOG_ERROR(std::string("fcntl(F_GETFL) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
-        return;
+EventLoop::Acceptor& EventLoop::acceptor_for(int listenFd) {
+    std::unique_ptr<Acceptor>& acceptor = acceptors_[listenFd];
+    if (!acceptor) {
+        acceptor = std::make_unique<Acceptor>();
+        acceptor->complete = &EventLoop::finish_accept;
+        acceptor->fd = listenFd;
+        acceptor->opcode = IORING_OP_ACCEPT;
     }
-    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
-        LOG_ERROR(std::string("fcntl(F_SETFL,O_NONBLOCK) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
+    return *acceptor;
+}
+
+bool EventLoop::arm_accept(Acceptor& acceptor) {
+    acceptor.flags = acceptor.multishot ? IoOperation::kMultishot : 0;
+    acceptor.armed = submit(acceptor);
+    return acceptor.armed;
+}
+
+bool EventLoop::take_accepted(int listenFd, AcceptAwaitable& awaiter) {
+    Acceptor& acceptor = acceptor_for(listenFd);
+    if (!acceptor.armed) {
+        arm_accept(acceptor);
+    }
+    if (acceptor.ready.empty()) {
+        return false;
+    }
+    int res = acceptor.ready.front();
+    acceptor.ready.pop_front();
+    awaiter.socket_ = res >= 0 ? res : kInvalidSocket;
+    awaiter.error_ = res >= 0 ? 0 : -res;
+    return true;
+}
+
+bool EventLoop::wait_accepted(int listenFd, AcceptAwaitable& awaiter, std::coroutine_handle<> h) {
+    Acceptor& acceptor = acceptor_for(listenFd);
+    if (!acceptor.armed && !arm_accept(acceptor)) {
+        awaiter.error_ = EBUSY;
+        return false;
+    }
+    acceptor.waiter = &awaiter;
+    acceptor.handle = h;
+    return true;
+}
+
+void EventLoop::finish_accept(IoOperation& op, int res, std::uint32_t flags) {
+    EventLoop& loop = EventLoop::instance();
+    auto& acceptor = static_cast<Acceptor&>(op);
+    // Без F_MORE операция больше не принимает соединения (ошибка, переполнение CQ) — её нужно
+    // поставить заново.
+    if (!(flags & IORING_CQE_F_MORE)) {
+        acceptor.armed = false;
+    }
+    if (res == -EINVAL && acceptor.multishot) {
+        // Ядро без multishot accept (до 5.19): одна операция на каждое соединение.
+        acceptor.multishot = false;
+        if (acceptor.waiter) {
+            loop.arm_accept(acceptor);
+        }
         return;
     }
+    if (AcceptAwaitable* waiter = std::exchange(acceptor.waiter, nullptr)) {
+        waiter->socket_ = res >= 0 ? res : kInvalidSocket;
+        waiter->error_ = res >= 0 ? 0 : -res;
+        std::exchange(acceptor.handle, {}).resume();
+    } else {
+        acceptor.ready.push_back(res);
+    }
+}
 
+void EventLoop::finish_wake(IoOperation& op, int /*res*/, std::uint32_t flags) {
+    EventLoop& loop = EventLoop::instance();
+    loop.drain_wakeups();
+    if (!(flags & IORING_CQE_F_MORE)) {
+        loop.submit(op);
+    }
+}
+
+EventLoop::FdState& EventLoop::slot(int fd) {
+    if (static_cast<size_t>(fd) >= fds_.size()) {
+        fds_.resize(std::max<size_t>(fd + 1, fds_.size() * 2));
+    }
+    return fds_[fd];
+}
+
+void EventLoop::watch(int fd) {
+    FdState& state = slot(fd);
+    if (state.registered) {
+        return;
+    }
+    // Оба направления сразу и фронтом: дальше ожидания не трогают epoll. При добавлении ядро
+    // сообщает текущую готовность, так что данные, пришедшие до регистрации, не теряются.
     epoll_event ev{};
-    ev.events = EPOLLOUT | EPOLLET;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
     ev.data.fd = fd;
+    ++syscalls_;
     if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
-        LOG_ERROR(std::string("epoll_ctl(ADD,EPOLLOUT) failed on fd=") +
-                  std::to_string(fd) + ": " + std::strerror(errno));
+        LOG_ERROR(std::string("epoll_ctl(ADD) failed on fd=") + std::to_string(fd) + ": " + std::strerror(errno));
+        return;
     }
+    state.registered = true;
+    LOG_TRACE(std::string("Registered fd=") + std::to_string(fd) + " for EPOLLIN | EPOLLOUT");
+}
 
-    std::lock_guard<std::mutex> lock(handlersMutex_);
-    handlers_[fd] = Handler{h, EPOLLOUT};
-    LOG_TRACE(std::string("Registered fd=") + std::to_string(fd) + " for EPOLLOUT");
+void EventLoop::add_reader(int fd, std::coroutine_handle<> h) {
+    watch(fd);
+    fds_[fd].reader = h;
+}
+
+void EventLoop::add_writer(int fd, std::coroutine_handle<> h) {
+    watch(fd);
+    fds_[fd].writer = h;
 }
 
 void EventLoop::remove(int fd) {
-    if (epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr) < 0) {
-        LOG_WARN(std::string("epoll_ctl(DEL) failed on fd=") +
-                 std::to_string(fd) + ": " + std::strerror(errno));
-    }
-    {
-        std::lock_guard<std::mutex> lock(handlersMutex_);
-        handlers_.erase(fd);
+    // close сам убирает дескриптор из epoll; номер может достаться новому соединению — его
+    // состояние начинается заново.
+    if (static_cast<size_t>(fd) < fds_.size()) {
+        fds_[fd] = FdState{};
     }
     if (close(fd) < 0) {
         LOG_WARN(std::string("close(fd) failed on fd=") +
@@ -259,16 +592,56 @@ void EventLoop::remove(int fd) {
     }
 }
 
+void EventLoop::set_wakeup_handler(std::function<void()> onWake) {
+    onWake_ = std::move(onWake);
+}
+
+void EventLoop::wakeup() {
+    std::uint64_t one = 1;
+    if (::write(wakeFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_WARN(std::string("eventfd write failed: ") + std::strerror(errno));
+    }
+}
+
+void EventLoop::drain_wakeups() {
+    std::uint64_t count;
+    ++syscalls_;
+    while (::read(wakeFd_, &count, sizeof(count)) > 0) {
+        ++syscalls_;
+    }
+    if (onWake_) {
+        onWake_();
+    }
+}
+
 void EventLoop::run() {
-    wait_and_handle_epoll();
+    if (backend_ == IoBackend::IoUring) {
+        wait_and_handle_uring();
+    } else {
+        wait_and_handle_epoll();
+    }
+}
+
+void EventLoop::wait_and_handle_uring() {
+    while (!stopped_.load(std::memory_order_relaxed)) {
+        int timeoutMs = run_due_timers();
+        // Все операции, поставленные корутинами с прошлого прохода, уходят в ядро этим же вызовом.
+        uring_->submit_and_wait(timeoutMs);
+        uring_->drain([](const io_uring_cqe& cqe) {
+            auto* op = reinterpret_cast<IoOperation*>(cqe.user_data);
+            op->complete(*op, cqe.res, cqe.flags);
+        });
+    }
 }
 
 void EventLoop::wait_and_handle_epoll() {
     const int MAX_EVENTS = 64;
     std::vector<epoll_event> events(MAX_EVENTS);
 
-    while (true) {
-        int n = epoll_wait(epollFd_, events.data(), MAX_EVENTS, -1);
+    while (!stopped_.load(std::memory_order_relaxed)) {
+        int timeoutMs = run_due_timers();
+        ++syscalls_;
+        int n = epoll_wait(epollFd_, events.data(), MAX_EVENTS, timeoutMs);
         if (n < 0) {
             if (errno == EINTR) {
                 continue;
@@ -279,29 +652,85 @@ void EventLoop::wait_and_handle_epoll() {
 
         for (int i = 0; i < n; ++i) {
             int fd = events[i].data.fd;
-            std::coroutine_handle<> handle;
-            {
-                std::lock_guard<std::mutex> lock(handlersMutex_);
-                auto it = handlers_.find(fd);
-                if (it != handlers_.end()) {
-                    handle = it->second.handle;
-                    handlers_.erase(it);
+            if (fd == wakeFd_) {
+                drain_wakeups();
+                continue;
+            }
+            // Ошибка и обрыв будят обе стороны: их операции сами получат результат.
+            std::uint32_t ready = events[i].events;
+            if (ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                fds_[fd].readable = true;
+                if (std::coroutine_handle<> reader = std::exchange(fds_[fd].reader, {})) {
+                    LOG_TRACE(std::string("Resuming reader for fd=") + std::to_string(fd));
+                    reader.resume();
                 }
             }
-            if (handle) {
-                LOG_TRACE(std::string("Resuming handle for fd=") + std::to_string(fd));
-                handle.resume();
+            // Читатель мог закрыть дескриптор (remove) или вырастить fds_ — обращаемся заново.
+            if ((ready & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && fds_[fd].registered) {
+                fds_[fd].writable = true;
+                if (std::coroutine_handle<> writer = std::exchange(fds_[fd].writer, {})) {
+                    LOG_TRACE(std::string("Resuming writer for fd=") + std::to_string(fd));
+                    writer.resume();
+                }
             }
         }
     }
 }
 
-void ReadAwaitable::await_suspend(std::coroutine_handle<> h) {
-    EventLoop::instance().add_reader(fd_, h);
+bool io_would_block() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// Результат операции io_uring в виде результата системного вызова: -1 и errno при ошибке.
+static ssize_t uring_result(int res) {
+    if (res < 0) {
+        errno = -res;
+        return -1;
+    }
+    return res;
+}
+
+// epoll: чтение, пока дескриптор помнится готовым. EAGAIN или неполное чтение значат, что
+// буфер сокета выбран, — следующее чтение ждёт события.
+static ssize_t read_now(EventLoop& loop, int fd, char* buffer, size_t size) {
+    loop.count_syscall();
+    ssize_t n = ::read(fd, buffer, size);
+    if ((n < 0 && io_would_block()) || (n > 0 && static_cast<size_t>(n) < size)) {
+        loop.reset_readable(fd);
+    }
+    return n;
+}
+
+bool ReadAwaitable::await_ready() {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() != IoBackend::Epoll || !loop.is_readable(fd_)) {
+        return false;
+    }
+    bytesRead_ = read_now(loop, fd_, buffer_, size_);
+    done_ = bytesRead_ >= 0 || !io_would_block();
+    return done_;
+}
+
+bool ReadAwaitable::await_suspend(std::coroutine_handle<> h) {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() == IoBackend::IoUring) {
+        op_.handle = h;
+        op_.fd = fd_;
+        op_.opcode = IORING_OP_RECV;
+        op_.data = buffer_;
+        op_.size = size_;
+        return loop.submit(op_);
+    }
+    loop.add_reader(fd_, h);
+    return true;
 }
 
 ssize_t ReadAwaitable::await_resume() {
-    bytesRead_ = ::read(fd_, buffer_, size_);
+    if (op_.handle) {
+        bytesRead_ = uring_result(op_.result);
+    } else if (!done_) {
+        bytesRead_ = read_now(EventLoop::instance(), fd_, buffer_, size_);
+    }
     if (bytesRead_ < 0) {
         if (errno != EAGAIN && errno != EWOULDBLOCK) {
             LOG_WARN(std::string("read() returned error on fd=") +
@@ -311,12 +740,92 @@ ssize_t ReadAwaitable::await_resume() {
     return bytesRead_;
 }
 
-void WriteAwaitable::await_suspend(std::coroutine_handle<> h) {
-    EventLoop::instance().add_writer(fd_, h);
+// Неблокирующий accept4; ошибка — в error. EAGAIN — очередь listen пуста до следующего события.
+static int try_accept(int listenFd, int& error) {
+    EventLoop& loop = EventLoop::instance();
+    loop.count_syscall();
+    int socket = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    error = socket < 0 ? errno : 0;
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        loop.reset_readable(listenFd);
+    }
+    return socket;
+}
+
+bool AcceptAwaitable::await_ready() {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() == IoBackend::IoUring) {
+        return loop.take_accepted(fd_, *this);
+    }
+    if (waitReady_ || !loop.is_readable(fd_)) {
+        return false;
+    }
+    socket_ = try_accept(fd_, error_);
+    return socket_ >= 0 || (error_ != EAGAIN && error_ != EWOULDBLOCK);
+}
+
+bool AcceptAwaitable::await_suspend(std::coroutine_handle<> h) {
+    EventLoop& loop = EventLoop::instance();
+    suspended_ = true;
+    if (loop.backend() == IoBackend::IoUring) {
+        return loop.wait_accepted(fd_, *this, h);
+    }
+    loop.add_reader(fd_, h);
+    return true;
+}
+
+SOCKET_TYPE AcceptAwaitable::await_resume() {
+    // epoll: сокет стал готов — соединение забирает повторный accept4 (с SO_REUSEPORT у каждого
+    // цикла свой сокет, но с общим сокетом его мог опередить другой цикл — тогда EAGAIN).
+    if (suspended_ && EventLoop::instance().backend() == IoBackend::Epoll) {
+        socket_ = try_accept(fd_, error_);
+    }
+    if (socket_ < 0) {
+        errno = error_;
+    }
+    return socket_;
+}
+
+// epoll: запись, пока дескриптор помнится готовым; EAGAIN или неполная запись — буфер сокета полон.
+static ssize_t write_now(EventLoop& loop, int fd, const char* buffer, size_t size) {
+    loop.count_syscall();
+    ssize_t n = ::write(fd, buffer, size);
+    if ((n < 0 && io_would_block()) || (n >= 0 && static_cast<size_t>(n) < size)) {
+        loop.reset_writable(fd);
+    }
+    return n;
+}
+
+bool WriteAwaitable::await_ready() {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() != IoBackend::Epoll || !loop.is_writable(fd_)) {
+        return false;
+    }
+    bytesWritten_ = write_now(loop, fd_, buffer_, size_);
+    done_ = bytesWritten_ >= 0 || !io_would_block();
+    return done_;
+}
+
+bool WriteAwaitable::await_suspend(std::coroutine_handle<> h) {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() == IoBackend::IoUring) {
+        op_.handle = h;
+        op_.fd = fd_;
+        op_.opcode = IORING_OP_SEND;
+        op_.data = const_cast<char*>(buffer_);
+        op_.size = size_;
+        return loop.submit(op_);
+    }
+    loop.add_writer(fd_, h);
+    return true;
 }
 
 ssize_t WriteAwaitable::await_resume() {
-    bytesWritten_ = ::write(fd_, buffer_, size_);
+    if (op_.handle) {
+        bytesWritten_ = uring_result(op_.result);
+    } else if (!done_) {
+        bytesWritten_ = write_now(EventLoop::instance(), fd_, buffer_, size_);
+    }
     if (bytesWritten_ < 0) {
         if (errno != EAGAIN && errno != EWOULDBLOCK) {
             LOG_WARN(std::string("write() returned error on fd=") +
@@ -326,6 +835,65 @@ ssize_t WriteAwaitable::await_resume() {
     return bytesWritten_;
 }
 
+static_assert(sizeof(IoSlice) == sizeof(iovec) && offsetof(IoSlice, data) == offsetof(iovec, iov_base) &&
+              offsetof(IoSlice, size) == offsetof(iovec, iov_len));
+
+// epoll: векторная запись по массиву фрагментов напрямую (раскладка совпадает с iovec).
+static ssize_t writev_now(EventLoop& loop, int fd, const IoSlice* slices, size_t count) {
+    count = std::min(count, MAX_IO_SLICES);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += slices[i].size;
+    }
+    loop.count_syscall();
+    ssize_t n = ::writev(fd, reinterpret_cast<const iovec*>(slices), static_cast<int>(count));
+    if ((n < 0 && io_would_block()) || (n >= 0 && static_cast<size_t>(n) < total)) {
+        loop.reset_writable(fd);
+    }
+    return n;
+}
+
+bool WritevAwaitable::await_ready() {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() != IoBackend::Epoll || !loop.is_writable(fd_)) {
+        return false;
+    }
+    bytesWritten_ = writev_now(loop, fd_, slices_, count_);
+    done_ = bytesWritten_ >= 0 || !io_would_block();
+    return done_;
+}
+
+bool WritevAwaitable::await_suspend(std::coroutine_handle<> h) {
+    EventLoop& loop = EventLoop::instance();
+    if (loop.backend() == IoBackend::IoUring) {
+        // Ядро читает массив фрагментов при отправке SQE, а он живёт, пока корутина ждёт результата.
+        msg_.msg_iov = reinterpret_cast<iovec*>(const_cast<IoSlice*>(slices_));
+        msg_.msg_iovlen = std::min(count_, MAX_IO_SLICES);
+        op_.handle = h;
+        op_.fd = fd_;
+        op_.opcode = IORING_OP_SENDMSG;
+        op_.data = &msg_;
+        return loop.submit(op_);
+    }
+    loop.add_writer(fd_, h);
+    return true;
+}
+
+ssize_t WritevAwaitable::await_resume() {
+    if (op_.handle) {
+        bytesWritten_ = uring_result(op_.result);
+    } else if (!done_) {
+        bytesWritten_ = writev_now(EventLoop::instance(), fd_, slices_, count_);
+    }
+    if (bytesWritten_ < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_WARN(std::string("writev() returned error on fd=") +
+                     std::to_string(fd_) + ": " + std::strerror(errno));
+        }
+    }
+    return bytesWritten_;
+}
+
 #endif  // _WIN32
 
 }  // namespace kv
@@ -0,0 +1,127 @@
+#include "kv/epoch.hpp"
+
+#include <thread>
+
+namespace kv {
+
+// Слот потока в EpochDomain; освобождается при завершении потока.
+struct EpochThreadState {
+    size_t slot = static_cast<size_t>(-1);
+    size_t depth = 0;
+
+    ~EpochThreadState() {
+        if (slot != static_cast<size_t>(-1)) {
+            EpochDomain::instance().release_slot(slot);
+        }
+    }
+};
+
+namespace {
+thread_local EpochThreadState tlsEpoch;
+}
+
+EpochDomain& EpochDomain::instance() {
+    static EpochDomain domain;
+    return domain;
+}
+
+size_t EpochDomain::acquire_slot() {
+    while (true) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            bool expected = false;
+            if (!slots_[i].used.load(std::memory_order_relaxed) &&
+                slots_[i].used.compare_exchange_strong(expected, true)) {
+                size_t hw = highWater_.load(std::memory_order_relaxed);
+                while (hw < i + 1 && !highWater_.compare_exchange_weak(hw, i + 1)) {
+                }
+                return i;
+            }
+        }
+        // Все слоты заняты живыми потоками — ждём, пока какой-нибудь завершится.
+        std::this_thread::yield();
+    }
+}
+
+void EpochDomain::release_slot(size_t idx) {
+    slots_[idx].epoch.store(0, std::memory_order_release);
+    slots_[idx].used.store(false, std::memory_order_release);
+}
+
+void EpochDomain::enter() {
+    EpochThreadState& st = tlsEpoch;
+    if (st.depth++ > 0) {
+        return;
+    }
+    if (st.slot == static_cast<size_t>(-1)) {
+        st.slot = acquire_slot();
+    }
+    // seq_cst-запись: последующие чтения указателей не могут "обогнать" публикацию эпохи.
+    // Если try_advance успел сдвинуть эпоху между чтением и публикацией, слот отстал бы на одну
+    // эпоху — перечитываем и публикуем заново, пока опубликованная эпоха не совпадёт с глобальной.
+    std::atomic<std::uint64_t>& epoch = slots_[st.slot].epoch;
+    std::uint64_t seen = global_.load(std::memory_order_seq_cst);
+    while (true) {
+        epoch.store(seen, std::memory_order_seq_cst);
+        std::uint64_t now = global_.load(std::memory_order_seq_cst);
+        if (now == seen) {
+            break;
+        }
+        seen = now;
+    }
+}
+
+void EpochDomain::exit() {
+    EpochThreadState& st = tlsEpoch;
+    if (--st.depth > 0) {
+        return;
+    }
+    slots_[st.slot].epoch.store(0, std::memory_order_release);
+}
+
+bool EpochDomain::try_advance() {
+    std::uint64_t g = global_.load(std::memory_order_seq_cst);
+    size_t hw = highWater_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < hw; ++i) {
+        std::uint64_t e = slots_[i].epoch.load(std::memory_order_seq_cst);
+        if (e != 0 && e != g) {
+            return false;
+        }
+    }
+    return global_.compare_exchange_strong(g, g + 1, std::memory_order_seq_cst);
+}
+
+void RetireList::retire(void* ptr, Deleter deleter, void* ctx) {
+    items_.push_back(Item{ptr, deleter, ctx, EpochDomain::instance().current()});
+}
+
+void RetireList::reclaim() {
+    if (items_.empty()) {
+        return;
+    }
+    EpochDomain& domain = EpochDomain::instance();
+    // Двух продвижений достаточно, чтобы освободить только что удалённое, если читателей нет.
+    if (domain.try_advance()) {
+        domain.try_advance();
+    }
+    std::uint64_t g = domain.current();
+
+    // Эпохи в items_ не убывают, поэтому освобождаем префикс. Запас в две эпохи: объект, удалённый
+    // в эпохе e, мог видеть читатель, опубликовавший e (или e - 1 до перечитывания в enter()), а
+    // try_advance не уходит дальше эпохи самого старого активного читателя + 1. Эпоха e + 2 значит,
+    // что все такие читатели вышли.
+    size_t n = 0;
+    while (n < items_.size() && items_[n].epoch + 2 <= g) {
+        items_[n].deleter(items_[n].ctx, items_[n].ptr);
+        ++n;
+    }
+    items_.erase(items_.begin(), items_.begin() + static_cast<std::ptrdiff_t>(n));
+}
+
+void RetireList::drain() {
+    for (auto& item : items_) {
+        item.deleter(item.ctx, item.ptr);
+    }
+    items_.clear();
+}
+
+}  // namespace kv
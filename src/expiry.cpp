@@ -0,0 +1,103 @@
+#include "kv/expiry.hpp"
+
+#include <algorithm>
+
+namespace kv {
+
+ExpiryWheel::ExpiryWheel(std::uint64_t nowMs) : tick_(nowMs / kv::config::EXPIRE_TICK_MS) {}
+
+void ExpiryWheel::link(PackedNode*& head, PackedNode* node) {
+    ExpiryLink& e = node->expiry();
+    e.next = head;
+    e.pprev = &head;
+    if (head) {
+        head->expiry().pprev = &e.next;
+    }
+    head = node;
+}
+
+void ExpiryWheel::unlink(PackedNode* node) {
+    ExpiryLink& e = node->expiry();
+    *e.pprev = e.next;
+    if (e.next) {
+        e.next->expiry().pprev = e.pprev;
+    }
+    e.next = nullptr;
+    e.pprev = nullptr;
+}
+
+// Уровень выбирается по расстоянию до срока, слот — по соответствующим разрядам абсолютного тика.
+void ExpiryWheel::place(PackedNode* node) {
+    std::uint64_t t = node->deadline() / kv::config::EXPIRE_TICK_MS;
+    if (t < tick_) {
+        t = tick_;
+    }
+    constexpr std::uint64_t kSpan = std::uint64_t{1} << (kSlotBits * kLevels);
+    if (t - tick_ >= kSpan) {
+        t = tick_ + kSpan - 1;
+    }
+
+    std::uint64_t delta = t - tick_;
+    unsigned level = 0;
+    while (level + 1 < kLevels && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+    link(slots_[level][(t >> (kSlotBits * level)) & (kSlots - 1)], node);
+}
+
+void ExpiryWheel::insert(PackedNode* node) {
+    place(node);
+    ++size_;
+}
+
+void ExpiryWheel::remove(PackedNode* node) {
+    if (node->expiry().pprev) {
+        unlink(node);
+        --size_;
+    }
+}
+
+bool ExpiryWheel::advance(std::uint64_t nowMs, size_t budget, ExpireFn onExpired, void* ctx) {
+    std::uint64_t target = nowMs / kv::config::EXPIRE_TICK_MS;
+    if (size_ == 0) {
+        tick_ = std::max(tick_, target);
+        return false;
+    }
+
+    while (tick_ < target) {
+        // Каскад: на границе интервала уровня его слот раскладывается по нижним уровням.
+        // Повторный вход после исчерпания бюджета дешёвый — уже разобранные слоты пусты.
+        for (unsigned level = kLevels - 1; level > 0; --level) {
+            if ((tick_ & ((std::uint64_t{1} << (kSlotBits * level)) - 1)) != 0) {
+                continue;
+            }
+            PackedNode*& head = slots_[level][(tick_ >> (kSlotBits * level)) & (kSlots - 1)];
+            while (head) {
+                if (budget == 0) {
+                    return true;
+                }
+                PackedNode* node = head;
+                unlink(node);
+                place(node);
+                --budget;
+            }
+        }
+
+        // Тик tick_ целиком в прошлом, значит всё в его слоте уровня 0 уже истекло.
+        PackedNode*& head = slots_[0][tick_ & (kSlots - 1)];
+        while (head) {
+            if (budget == 0) {
+                return true;
+            }
+            PackedNode* node = head;
+            unlink(node);
+            --size_;
+            onExpired(ctx, node);
+            --budget;
+        }
+        ++tick_;
+    }
+    return false;
+}
+
+}  // namespace kv
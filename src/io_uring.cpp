@@ -0,0 +1,200 @@
+#include "kv/io_uring.hpp"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "kv/logger.hpp"
+
+namespace kv {
+
+namespace {
+
+void* map_ring(int fd, size_t bytes, off_t offset) {
+    void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+void* map_anonymous(size_t bytes) {
+    void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+}  // namespace
+
+IoUring::~IoUring() {
+    if (sqes_) {
+        ::munmap(sqes_, sqesBytes_);
+    }
+    if (ring_) {
+        ::munmap(ring_, ringBytes_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (bufRing_) {
+        ::munmap(bufRing_, bufRingBytes_);
+    }
+    if (buffers_) {
+        ::munmap(buffers_, buffersBytes_);
+    }
+}
+
+bool IoUring::init(unsigned entries) {
+    // Кольцо использует только поток цикла: ядру не нужно синхронизировать отправку, а работа по
+    // завершениям выполняется, когда поток сам ждёт их (DEFER_TASKRUN). Старые ядра этих флагов
+    // не знают — тогда кольцо без них.
+    io_uring_params params{};
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0 && errno == EINVAL) {
+        params = io_uring_params{};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    }
+    if (fd_ < 0) {
+        LOG_DEBUG(std::string("io_uring_setup() failed: ") + std::strerror(errno));
+        return false;
+    }
+    // Одно отображение на оба кольца, завершения без потерь при переполнении CQ и таймаут ожидания
+    // в io_uring_enter — всё это есть с ядра 5.11.
+    constexpr unsigned kRequired = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & kRequired) != kRequired) {
+        LOG_DEBUG("io_uring lacks SINGLE_MMAP/NODROP/EXT_ARG");
+        return false;
+    }
+
+    ringBytes_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                          params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ = map_ring(fd_, ringBytes_, IORING_OFF_SQ_RING);
+    sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map_ring(fd_, sqesBytes_, IORING_OFF_SQES));
+    if (!ring_ || !sqes_) {
+        LOG_DEBUG(std::string("io_uring mmap failed: ") + std::strerror(errno));
+        return false;
+    }
+
+    char* ring = static_cast<char*>(ring_);
+    sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqLocalTail_ = *sqTail_;
+
+    cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+    cqMask_ = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    return true;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize) {
+    ++enters_;
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, flags, arg, argSize));
+    // ETIME — истёк таймаут ожидания, EINTR — сигнал; EBUSY/EAGAIN — ядру нужно сначала отдать
+    // завершения, их заберёт drain().
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+        LOG_ERROR(std::string("io_uring_enter() failed: ") + std::strerror(errno));
+    }
+    return ret;
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    if (sqLocalTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire) == sqEntries_) {
+        submit();
+        if (sqLocalTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire) == sqEntries_) {
+            return nullptr;
+        }
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    return sqe;
+}
+
+void IoUring::submit() {
+    std::atomic_ref<unsigned>(*sqTail_).store(sqLocalTail_, std::memory_order_release);
+    unsigned pending = sqLocalTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+    if (pending != 0) {
+        enter(pending, 0, 0, nullptr, 0);
+    }
+}
+
+void IoUring::submit_and_wait(int timeoutMs) {
+    std::atomic_ref<unsigned>(*sqTail_).store(sqLocalTail_, std::memory_order_release);
+    unsigned pending = sqLocalTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    unsigned minComplete = timeoutMs == 0 ? 0 : 1;
+    if (timeoutMs <= 0) {
+        enter(pending, minComplete, flags, nullptr, _NSIG / 8);
+        return;
+    }
+    __kernel_timespec ts{};
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+    enter(pending, minComplete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+bool IoUring::setup_buffers(unsigned count, size_t size) {
+    bufRingBytes_ = count * sizeof(io_uring_buf);
+    bufRing_ = static_cast<io_uring_buf_ring*>(map_anonymous(bufRingBytes_));
+    buffersBytes_ = count * size;
+    buffers_ = static_cast<char*>(map_anonymous(buffersBytes_));
+    if (!bufRing_ || !buffers_) {
+        LOG_WARN(std::string("io_uring buffer ring mmap failed: ") + std::strerror(errno));
+        return false;
+    }
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<std::uint64_t>(bufRing_);
+    reg.ring_entries = count;
+    reg.bgid = kBufferGroup;
+    ++enters_;
+    if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        // Ядро до 5.19: recv читает прямо в буфер соединения.
+        LOG_DEBUG(std::string("IORING_REGISTER_PBUF_RING failed: ") + std::strerror(errno));
+        ::munmap(bufRing_, bufRingBytes_);
+        bufRing_ = nullptr;
+        return false;
+    }
+
+    bufferSize_ = size;
+    bufMask_ = count - 1;
+    for (unsigned id = 0; id < count; ++id) {
+        add_buffer(id);
+    }
+    std::atomic_ref<std::uint16_t>(bufRing_->tail).store(bufTail_, std::memory_order_release);
+    return true;
+}
+
+void IoUring::add_buffer(unsigned id) {
+    // Слоты считаются от начала кольца: в C++ __DECLARE_FLEX_ARRAY сдвигает bufs на 8 байт
+    // (пустая структура перед массивом), а ядро ждёт их с нулевого смещения.
+    io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(bufRing_)[bufTail_ & bufMask_];
+    buf.addr = reinterpret_cast<std::uint64_t>(buffers_ + id * bufferSize_);
+    buf.len = static_cast<std::uint32_t>(bufferSize_);
+    buf.bid = static_cast<std::uint16_t>(id);
+    ++bufTail_;
+}
+
+void IoUring::recycle(unsigned id) {
+    add_buffer(id);
+    std::atomic_ref<std::uint16_t>(bufRing_->tail).store(bufTail_, std::memory_order_release);
+}
+
+}  // namespace kv
+
+#endif  // __linux__
@@ -0,0 +1,215 @@
+#include "kv/lz.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace kv::lz {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kHashBits = 12;
+constexpr size_t kMaxOffset = 65535;
+// Последние байты входа всегда идут литералами: совпадение не начинается ближе kMatchLimit
+// к концу и не заходит в последние kLastLiterals байт (как в LZ4 — декодер копирует без проверок хвоста).
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchLimit = 12;
+
+std::atomic<std::uint64_t> rawBytes{0};
+std::atomic<std::uint64_t> compressedBytes{0};
+std::atomic<std::uint64_t> skipped{0};
+std::atomic<std::uint64_t> compressNs{0};
+std::atomic<std::uint64_t> decompressNs{0};
+
+std::uint32_t read32(const char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+std::uint32_t hash4(const char* p) { return (read32(p) * 2654435761u) >> (32 - kHashBits); }
+
+// Длина (литералов или совпадения) сверх 15: байты по 255 и остаток.
+char* write_length(char* op, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *op++ = static_cast<char>(255);
+    }
+    *op++ = static_cast<char>(len);
+    return op;
+}
+
+bool read_length(const unsigned char*& ip, const unsigned char* end, size_t& len) {
+    unsigned char b;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+}  // namespace
+
+size_t compress(const char* src, size_t n, char* dst, size_t capacity) {
+    std::uint32_t table[1u << kHashBits] = {};  // позиция + 1; 0 — пусто
+    const char* ip = src;
+    const char* anchor = src;
+    const char* end = src + n;
+    char* op = dst;
+    char* opEnd = dst + capacity;
+
+    auto emit = [&](const char* literals, size_t litLen, size_t offset, size_t matchLen) {
+        // Худший случай: токен, длины, литералы и смещение.
+        if (static_cast<size_t>(opEnd - op) < 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1) {
+            return false;
+        }
+        char* token = op++;
+        *token = static_cast<char>((litLen < 15 ? litLen : 15) << 4);
+        if (litLen >= 15) {
+            op = write_length(op, litLen - 15);
+        }
+        std::memcpy(op, literals, litLen);
+        op += litLen;
+        if (matchLen == 0) {
+            return true;
+        }
+        op[0] = static_cast<char>(offset & 0xff);
+        op[1] = static_cast<char>(offset >> 8);
+        op += 2;
+        size_t code = matchLen - kMinMatch;
+        *token = static_cast<char>(*token | (code < 15 ? code : 15));
+        if (code >= 15) {
+            op = write_length(op, code - 15);
+        }
+        return true;
+    };
+
+    if (n >= kMatchLimit) {
+        const char* matchStart = end - kMatchLimit;
+        const char* matchEnd = end - kLastLiterals;
+        while (ip <= matchStart) {
+            std::uint32_t h = hash4(ip);
+            std::uint32_t candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(ip - src) + 1;
+            if (candidate == 0 || static_cast<size_t>(ip - src) + 1 - candidate > kMaxOffset ||
+                read32(src + candidate - 1) != read32(ip)) {
+                // Несжимаемые участки проходятся всё более крупным шагом.
+                ip += 1 + (static_cast<size_t>(ip - anchor) >> 6);
+                continue;
+            }
+            const char* ref = src + candidate - 1;
+            size_t len = kMinMatch;
+            while (ip + len < matchEnd && ref[len] == ip[len]) {
+                ++len;
+            }
+            if (!emit(anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref), len)) {
+                return 0;
+            }
+            ip += len;
+            anchor = ip;
+        }
+    }
+    if (!emit(anchor, static_cast<size_t>(end - anchor), 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - dst);
+}
+
+bool decompress(const char* src, size_t n, char* dst, size_t rawSize) {
+    const auto* ip = reinterpret_cast<const unsigned char*>(src);
+    const auto* end = ip + n;
+    char* op = dst;
+    char* opEnd = dst + rawSize;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !read_length(ip, end, litLen)) {
+            return false;
+        }
+        if (litLen > static_cast<size_t>(end - ip) || litLen > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == end) {
+            break;  // последняя команда — только литералы
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !read_length(ip, end, matchLen)) {
+            return false;
+        }
+        matchLen += kMinMatch;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || matchLen > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        // Совпадение может перекрывать само себя (offset < matchLen) — копируем побайтно.
+        const char* ref = op - offset;
+        for (size_t i = 0; i < matchLen; ++i) {
+            op[i] = ref[i];
+        }
+        op += matchLen;
+    }
+    return op == opEnd;
+}
+
+bool pack(std::string_view value, std::string& out) {
+    auto start = std::chrono::steady_clock::now();
+    // Ёмкость — на байт меньше исходного значения: иначе сжатие ничего не даёт.
+    out.resize(value.size());
+    size_t n = value.size() > kPackedHeader ? compress(value.data(), value.size(), out.data() + kPackedHeader,
+                                                       value.size() - kPackedHeader - 1)
+                                            : 0;
+    compressNs.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+    if (n == 0) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    auto raw = static_cast<std::uint32_t>(value.size());
+    std::memcpy(out.data(), &raw, sizeof(raw));
+    out.resize(kPackedHeader + n);
+    rawBytes.fetch_add(value.size(), std::memory_order_relaxed);
+    compressedBytes.fetch_add(out.size(), std::memory_order_relaxed);
+    return true;
+}
+
+size_t unpacked_size(std::string_view packed) {
+    std::uint32_t raw;
+    std::memcpy(&raw, packed.data(), sizeof(raw));
+    return raw;
+}
+
+bool unpack(std::string_view packed, std::string& out) {
+    if (packed.size() < kPackedHeader) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    out.resize(unpacked_size(packed));
+    std::string_view data = packed_data(packed);
+    bool ok = decompress(data.data(), data.size(), out.data(), out.size());
+    decompressNs.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+    return ok;
+}
+
+Stats stats() {
+    return {rawBytes.load(std::memory_order_relaxed), compressedBytes.load(std::memory_order_relaxed),
+            skipped.load(std::memory_order_relaxed), compressNs.load(std::memory_order_relaxed),
+            decompressNs.load(std::memory_order_relaxed)};
+}
+
+}  // namespace kv::lz
@@ -0,0 +1,46 @@
+#include "kv/request_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace kv {
+
+std::optional<std::string_view> RequestBuffer::next_line() {
+    const char* base = data_.data();
+    const void* found = std::memchr(base + scanned_, '\n', end_ - scanned_);
+    if (!found) {
+        scanned_ = end_;
+        return std::nullopt;
+    }
+    size_t newline = static_cast<size_t>(static_cast<const char*>(found) - base);
+    std::string_view line(base + begin_, newline - begin_);
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    begin_ = scanned_ = newline + 1;
+    return line;
+}
+
+std::span<char> RequestBuffer::prepare() {
+    // Выданные строки больше не нужны: хвост переезжает в начало.
+    if (begin_ != 0) {
+        std::memmove(data_.data(), data_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        scanned_ -= begin_;
+        begin_ = 0;
+    }
+    size_t chunk = kv::config::CONNECTION_BUFFER_SIZE;
+    if (end_ == 0 && data_.size() > chunk) {
+        // Крупная команда выполнена — соединение не держит под неё память дальше.
+        data_ = std::vector<char>(chunk);
+    }
+    if (data_.size() - end_ < chunk / 2) {
+        // Запас сверх предела: хвост, переваливший за MAX_REQUEST_SIZE, ещё должен поместиться,
+        // чтобы overflow() его заметил.
+        size_t limit = kv::config::MAX_REQUEST_SIZE + chunk;
+        data_.resize(std::min(std::max(data_.size() * 2, end_ + chunk), limit));
+    }
+    return {data_.data() + end_, data_.size() - end_};
+}
+
+}  // namespace kv
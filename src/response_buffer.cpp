@@ -0,0 +1,66 @@
+#include "kv/response_buffer.hpp"
+
+#include <algorithm>
+
+namespace kv {
+
+void ResponseBuffer::append(std::string_view bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+    if (pieces_.size() > head_ && pieces_.back().data == nullptr &&
+        pieces_.back().offset + pieces_.back().size == bytes_.size()) {
+        pieces_.back().size += bytes.size();
+    } else {
+        pieces_.push_back(Piece{nullptr, bytes_.size(), bytes.size()});
+    }
+    bytes_.append(bytes);
+    pending_ += bytes.size();
+}
+
+void ResponseBuffer::append_ref(std::string_view bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+    pieces_.push_back(Piece{bytes.data(), 0, bytes.size()});
+    pending_ += bytes.size();
+}
+
+std::span<const IoSlice> ResponseBuffer::slices() {
+    iov_.clear();
+    for (size_t i = head_; i < pieces_.size(); ++i) {
+        const Piece& piece = pieces_[i];
+        const char* data = piece.data ? piece.data : bytes_.data() + piece.offset;
+        iov_.push_back(IoSlice{data, piece.size});
+    }
+    return iov_;
+}
+
+void ResponseBuffer::consume(size_t n) {
+    pending_ -= n;
+    while (n > 0) {
+        Piece& piece = pieces_[head_];
+        size_t taken = std::min(n, piece.size);
+        if (piece.data) {
+            piece.data += taken;
+        } else {
+            piece.offset += taken;
+        }
+        piece.size -= taken;
+        n -= taken;
+        if (piece.size == 0) {
+            ++head_;
+        }
+    }
+    if (pending_ == 0) {
+        pieces_.clear();
+        head_ = 0;
+        bytes_.clear();
+        // Крупный ответ (INFO, SCAN) отправлен — соединение не держит под него память дальше.
+        if (bytes_.capacity() > kv::config::RESPONSE_FLUSH_BYTES) {
+            bytes_.shrink_to_fit();
+        }
+    }
+}
+
+}  // namespace kv
@@ -0,0 +1,75 @@
+// Магазины MemoryPool при завершении потока: ячейки возвращаются аренам, а освобождения из
+// поздних thread_local-деструкторов не попадают в магазин освобождённого номера.
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/allocator.hpp"
+
+namespace {
+
+// Освобождает ячейки в деструкторе — как thread_local-буферы, разрушаемые после магазина потока.
+struct LateFree {
+    kv::MemoryPool* pool = nullptr;
+    std::vector<void*> cells;
+
+    ~LateFree() {
+        for (void* cell : cells) {
+            pool->deallocate(cell);
+        }
+    }
+};
+
+void test_thread_exit_returns_cells() {
+    kv::MemoryPool pool(64, 16);
+    std::thread([&pool] {
+        // Создаётся до первого обращения к пулу, поэтому разрушается уже после сброса магазинов.
+        thread_local LateFree late;
+        late.pool = &pool;
+        std::vector<void*> cells;
+        for (int i = 0; i < 12; ++i) {
+            cells.push_back(pool.allocate());
+        }
+        late.cells.assign(cells.begin() + 6, cells.end());
+        for (int i = 0; i < 6; ++i) {
+            pool.deallocate(cells[i]);  // в магазин потока
+        }
+    }).join();
+
+    // Все ячейки вернулись в арену, и она опустела: trim() оставляет её запасной со сброшенными
+    // страницами. Если бы ячейки остались в магазине, арена не была бы пустой.
+    KV_CHECK_EQ(pool.trim(), kv::config::POOL_ARENA_BYTES);
+}
+
+// Номер завершившегося потока сразу достаётся следующему: магазин начинает с нуля и работает.
+void test_slot_reuse() {
+    kv::MemoryPool pool(64, 16);
+    for (int round = 0; round < 4; ++round) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&pool] {
+                std::vector<void*> cells;
+                for (int i = 0; i < 1000; ++i) {
+                    cells.push_back(pool.allocate());
+                }
+                for (void* cell : cells) {
+                    pool.deallocate(cell);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    KV_CHECK_EQ(pool.trim(), kv::config::POOL_ARENA_BYTES);
+}
+
+}  // namespace
+
+int main() {
+    test_thread_exit_returns_cells();
+    test_slot_reuse();
+    std::printf("allocator_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+// файл: tests/check.hpp
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Проверки для тестов без сторонних фреймворков: при провале печатают место и условие и
+// завершают процесс с кодом 1 (его видит CTest). _Exit не ждёт потоков сервера и статических
+// деструкторов, которые они ещё используют.
+#define KV_CHECK(cond)                                                              \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::fprintf(stderr, "%s:%d: проверка не прошла: %s\n", __FILE__, __LINE__, #cond); \
+            std::fflush(stderr);                                                    \
+            std::_Exit(1);                                                          \
+        }                                                                           \
+    } while (0)
+
+#define KV_CHECK_EQ(actual, expected)                                                         \
+    do {                                                                                      \
+        if (!((actual) == (expected))) {                                                      \
+            std::fprintf(stderr, "%s:%d: проверка не прошла: %s == %s\n", __FILE__, __LINE__, \
+                         #actual, #expected);                                                 \
+            std::fflush(stderr);                                                              \
+            std::_Exit(1);                                                                    \
+        }                                                                                     \
+    } while (0)
@@ -0,0 +1,104 @@
+// EpochDomain/RetireList: объект не освобождается, пока его может видеть читатель в своей
+// секции, и освобождается, когда все такие читатели вышли.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/epoch.hpp"
+
+namespace {
+
+struct Object {
+    std::atomic<std::uint64_t> value;
+};
+
+constexpr std::uint64_t kPoisoned = 0xDEADDEADDEADDEADULL;
+
+void poison_and_free(void*, void* ptr) {
+    auto* object = static_cast<Object*>(ptr);
+    object->value.store(kPoisoned, std::memory_order_relaxed);
+    delete object;
+}
+
+void count_free(void* ctx, void*) { static_cast<std::atomic<int>*>(ctx)->fetch_add(1); }
+
+// Читатель держит секцию — удалённый объект ждёт; вышел — объект освобождается.
+void test_reader_blocks_reclaim() {
+    std::atomic<int> freed{0};
+    std::atomic<bool> inside{false};
+    std::atomic<bool> leave{false};
+    std::thread reader([&] {
+        kv::EpochGuard guard;
+        inside.store(true);
+        while (!leave.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!inside.load()) {
+        std::this_thread::yield();
+    }
+
+    kv::RetireList retired;
+    int token = 0;
+    retired.retire(&token, &count_free, &freed);
+    for (int i = 0; i < 100; ++i) {
+        retired.reclaim();
+    }
+    KV_CHECK_EQ(freed.load(), 0);
+    KV_CHECK_EQ(retired.pending(), 1u);
+
+    leave.store(true);
+    reader.join();
+    retired.reclaim();
+    KV_CHECK_EQ(freed.load(), 1);
+    KV_CHECK_EQ(retired.pending(), 0u);
+}
+
+// Читатели без блокировки разыменовывают текущий объект, писатель подменяет и удаляет его:
+// читатель ни разу не видит освобождённый (отравленный) объект.
+void test_readers_never_see_freed() {
+    std::atomic<Object*> current{new Object{{1}}};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                kv::EpochGuard guard;
+                Object* object = current.load(std::memory_order_acquire);
+                for (int i = 0; i < 16; ++i) {
+                    if (object->value.load(std::memory_order_relaxed) == kPoisoned) {
+                        failed.store(true);
+                    }
+                }
+            }
+        });
+    }
+
+    kv::RetireList retired;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    for (std::uint64_t v = 2; std::chrono::steady_clock::now() < deadline; ++v) {
+        Object* old = current.exchange(new Object{{v}}, std::memory_order_acq_rel);
+        retired.retire(old, &poison_and_free, nullptr);
+        retired.reclaim();
+    }
+    stop.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    KV_CHECK(!failed.load());
+    retired.drain();
+    delete current.load();
+}
+
+}  // namespace
+
+int main() {
+    test_reader_blocks_reclaim();
+    test_readers_never_see_freed();
+    std::printf("epoch_test: OK\n");
+    return 0;
+}
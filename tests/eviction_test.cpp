@@ -0,0 +1,96 @@
+// Бюджет памяти шарда: массив корзин не вытесняет ключи, метка доступа меняется только со сдвигом
+// часов шарда.
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include "check.hpp"
+#include "kv/eviction.hpp"
+#include "kv/hash_table.hpp"
+
+namespace {
+
+using Table = kv::HashTable<std::string, std::string>;
+
+// Корзины (4096 указателей, 32 КБ) сами больше бюджета, но ключи в него помещаются — вытеснять нечего.
+void test_buckets_do_not_count() {
+    constexpr size_t kKeys = 300;
+    Table table(4096);
+    table.set_max_memory(30 * 1024, kv::config::EvictionPolicy::LRU);
+    KV_CHECK(table.memory_usage() > 30 * 1024);
+    for (size_t i = 0; i < kKeys; ++i) {
+        table.put("key" + std::to_string(i), std::string(16, 'v'));
+    }
+    KV_CHECK_EQ(table.size(), kKeys);
+    KV_CHECK_EQ(table.evictions(), 0u);
+    for (size_t i = 0; i < kKeys; ++i) {
+        KV_CHECK(table.get("key" + std::to_string(i)).has_value());
+    }
+}
+
+// За бюджетом ключи вытесняются, но не все: последний записанный остаётся.
+void test_eviction_keeps_latest() {
+    Table table(16);
+    table.set_max_memory(16 * 1024, kv::config::EvictionPolicy::LRU);
+    for (int i = 0; i < 5000; ++i) {
+        table.put("key" + std::to_string(i), std::string(64, 'v'));
+    }
+    KV_CHECK(table.evictions() > 0);
+    KV_CHECK(table.size() > 0);
+    KV_CHECK(table.get("key4999").has_value());
+}
+
+// Пока часы шарда стоят, touch не пишет метку LRU; у LFU между записями растёт только счётчик.
+void test_touch_waits_for_clock() {
+    using kv::config::EvictionPolicy;
+    std::atomic<std::uint32_t> access{kv::access_stamp::make(7, 0)};
+    for (int i = 0; i < 100; ++i) {
+        kv::access_stamp::touch(access, 7, EvictionPolicy::LRU);
+    }
+    KV_CHECK_EQ(access.load(), kv::access_stamp::make(7, 0));
+    kv::access_stamp::touch(access, 8, EvictionPolicy::LRU);
+    KV_CHECK_EQ(access.load(), kv::access_stamp::make(8, 0));
+
+    access.store(kv::access_stamp::make(7, kv::access_stamp::kLfuInit));
+    for (int i = 0; i < 1000; ++i) {
+        kv::access_stamp::touch(access, 7, EvictionPolicy::LFU);
+    }
+    KV_CHECK_EQ(access.load() >> 8, 7u);
+    KV_CHECK(kv::access_stamp::counter(access.load()) > kv::access_stamp::kLfuInit);
+}
+
+// LFU: ключ, который много читали в фазе без записей, переживает вытеснение, а ключи,
+// прочитанные по разу (уже после следующей записи в шард), уходят.
+void test_lfu_keeps_read_heavy_key() {
+    Table table(1024);
+    table.set_max_memory(64 * 1024, kv::config::EvictionPolicy::LFU);
+    table.put(std::string("hot"), std::string(64, 'h'));
+    for (int i = 0; i < 200; ++i) {
+        table.put("warm" + std::to_string(i), std::string(64, 'w'));
+    }
+    for (int i = 0; i < 10000; ++i) {
+        KV_CHECK(table.get(std::string("hot")).has_value());
+    }
+    for (int i = 0; i < 200; ++i) {
+        table.get("warm" + std::to_string(i));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        table.put("cold" + std::to_string(i), std::string(64, 'c'));
+        if (i > 0) {
+            table.get("cold" + std::to_string(i - 1));
+        }
+    }
+    KV_CHECK(table.evictions() > 1000);
+    KV_CHECK(table.get(std::string("hot")).has_value());
+}
+
+}  // namespace
+
+int main() {
+    test_buckets_do_not_count();
+    test_eviction_keeps_latest();
+    test_touch_waits_for_clock();
+    test_lfu_keeps_read_heavy_key();
+    std::printf("eviction_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,117 @@
+// ExpiryWheel: каскад с верхних уровней, срабатывание в свой тик и по порядку сроков, бюджет
+// advance и снятие узла с колеса.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/expiry.hpp"
+
+namespace {
+
+constexpr std::uint64_t kTick = kv::config::EXPIRE_TICK_MS;
+
+struct Expired {
+    std::uint64_t nowMs = 0;
+    std::vector<std::pair<kv::PackedNode*, std::uint64_t>> nodes;  // узел и время срабатывания
+
+    static void on_expired(void* ctx, kv::PackedNode* node) {
+        auto* self = static_cast<Expired*>(ctx);
+        self->nodes.emplace_back(node, self->nowMs);
+    }
+};
+
+kv::PackedNode* make_node(std::uint64_t deadlineMs) {
+    return kv::PackedNode::create(0, "k" + std::to_string(deadlineMs), "v", nullptr, deadlineMs);
+}
+
+// Сроки на всех четырёх уровнях (64, 64^2, 64^3 тиков): каждый узел срабатывает в первом тике
+// после своего срока, в порядке сроков.
+void test_cascade_order() {
+    kv::ExpiryWheel wheel(0);
+    const std::uint64_t ticks[] = {300000, 1, 4096, 63, 5000, 64, 4095, 65, 262143, 262144, 2, 100};
+    std::vector<kv::PackedNode*> nodes;
+    for (std::uint64_t t : ticks) {
+        nodes.push_back(make_node(t * kTick + kTick / 2));
+        wheel.insert(nodes.back());
+    }
+    KV_CHECK_EQ(wheel.size(), nodes.size());
+
+    Expired expired;
+    for (std::uint64_t t = 0; t <= 300002; ++t) {
+        expired.nowMs = t * kTick;
+        KV_CHECK(!wheel.advance(expired.nowMs, 1000, &Expired::on_expired, &expired));
+    }
+    KV_CHECK_EQ(wheel.size(), 0u);
+    KV_CHECK_EQ(expired.nodes.size(), nodes.size());
+    std::uint64_t previous = 0;
+    for (auto [node, at] : expired.nodes) {
+        KV_CHECK(at >= node->deadline());
+        KV_CHECK(at < node->deadline() + kTick);
+        KV_CHECK(node->deadline() >= previous);
+        previous = node->deadline();
+        node->release();
+    }
+}
+
+// Срок в прошлом срабатывает на ближайшем тике; срок дальше охвата колеса — не раньше своего.
+void test_past_and_far_deadlines() {
+    kv::ExpiryWheel wheel(1000 * kTick);
+    kv::PackedNode* past = make_node(10 * kTick);
+    kv::PackedNode* far = make_node((1000 + (std::uint64_t{1} << 24) + 50) * kTick);
+    wheel.insert(past);
+    wheel.insert(far);
+
+    Expired expired;
+    expired.nowMs = 1001 * kTick;
+    wheel.advance(expired.nowMs, 1000, &Expired::on_expired, &expired);
+    KV_CHECK_EQ(expired.nodes.size(), 1u);
+    KV_CHECK(expired.nodes[0].first == past);
+
+    // Перескок сразу на срок дальнего узла: колесо догоняет тики и перекладывает его заново.
+    expired.nowMs = far->deadline() + kTick;
+    while (wheel.advance(expired.nowMs, 1u << 20, &Expired::on_expired, &expired)) {
+    }
+    KV_CHECK_EQ(expired.nodes.size(), 2u);
+    KV_CHECK(expired.nodes[1].first == far);
+    past->release();
+    far->release();
+}
+
+// Бюджет ограничивает число узлов за вызов; снятый узел не срабатывает.
+void test_budget_and_remove() {
+    kv::ExpiryWheel wheel(0);
+    std::vector<kv::PackedNode*> nodes;
+    for (int i = 0; i < 10; ++i) {
+        nodes.push_back(make_node(5 * kTick + static_cast<std::uint64_t>(i)));
+        wheel.insert(nodes.back());
+    }
+    wheel.remove(nodes[3]);
+    wheel.remove(nodes[3]);  // повторное снятие ничего не делает
+    KV_CHECK_EQ(wheel.size(), 9u);
+
+    Expired expired;
+    expired.nowMs = 10 * kTick;
+    int calls = 0;
+    while (wheel.advance(expired.nowMs, 2, &Expired::on_expired, &expired)) {
+        ++calls;
+    }
+    KV_CHECK_EQ(expired.nodes.size(), 9u);
+    KV_CHECK(calls >= 4);
+    for (auto [node, at] : expired.nodes) {
+        KV_CHECK(node != nodes[3]);
+    }
+    for (kv::PackedNode* node : nodes) {
+        node->release();
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_cascade_order();
+    test_past_and_far_deadlines();
+    test_budget_and_remove();
+    std::printf("expiry_wheel_test: OK\n");
+    return 0;
+}
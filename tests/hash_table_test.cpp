@@ -0,0 +1,160 @@
+// HashTable: SCAN во время инкрементального rehash и чтение без блокировок, пока писатель
+// заменяет, удаляет и переносит узлы.
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/hash_table.hpp"
+
+namespace {
+
+using Table = kv::HashTable<std::string, std::string>;
+
+// Сколько ключей вставить в пустую таблицу, чтобы начался rehash.
+int keys_to_rehash() {
+    Table table(1024);
+    int keys = 0;
+    while (!table.rehashing()) {
+        table.put("old" + std::to_string(keys++), "v");
+    }
+    return keys;
+}
+
+// Полный SCAN по несколько ключей за шаг, между шагами — вставка нового ключа (она же переносит
+// очередные корзины rehash). Каждый из preload ключей, лежавших в таблице весь обход, выдан хотя
+// бы раз, а курсор возвращается в 0. Возвращает, сколько шагов SCAN пришлось на rehash.
+int scan_with_inserts(int preload) {
+    Table table(1024);
+    for (int i = 0; i < preload; ++i) {
+        table.put("old" + std::to_string(i), "v");
+    }
+    std::unordered_set<std::string> seen;
+    std::uint64_t cursor = 0;
+    int steps = 0;
+    int rehashingSteps = 0;
+    do {
+        rehashingSteps += table.rehashing() ? 1 : 0;
+        cursor = table.scan(cursor, 4, [&](const auto& key) { seen.emplace(key); });
+        table.put("new" + std::to_string(steps), "v");
+        KV_CHECK(++steps < 100000);
+    } while (cursor != 0);
+    for (int i = 0; i < preload; ++i) {
+        KV_CHECK(seen.contains("old" + std::to_string(i)));
+    }
+    return rehashingSteps;
+}
+
+// Обход начат, когда rehash уже идёт, и когда rehash начинается посреди обхода.
+void test_scan_while_rehashing() {
+    int threshold = keys_to_rehash();
+    KV_CHECK(scan_with_inserts(threshold) > 0);
+    KV_CHECK(scan_with_inserts(threshold - 20) > 0);
+}
+
+// Значение поколения gen ключа key: "key|gen|" и хвост из одной буквы, длина и буква которого
+// зависят от gen. Разорванное или прочитанное из освобождённой ячейки значение не пройдёт проверку.
+std::string make_value(std::string_view key, std::uint64_t gen) {
+    std::string value(key);
+    value += '|' + std::to_string(gen) + '|';
+    value.append(8 + gen % 200, static_cast<char>('a' + gen % 26));
+    return value;
+}
+
+bool valid_value(std::string_view key, std::string_view value) {
+    if (!value.starts_with(key) || value.size() <= key.size() || value[key.size()] != '|') {
+        return false;
+    }
+    value.remove_prefix(key.size() + 1);
+    std::uint64_t gen = 0;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), gen);
+    if (ec != std::errc() || end == value.data() + value.size() || *end != '|') {
+        return false;
+    }
+    std::string_view tail(end + 1, value.data() + value.size() - end - 1);
+    return tail.size() == 8 + gen % 200 &&
+           tail.find_first_not_of(static_cast<char>('a' + gen % 26)) == std::string_view::npos;
+}
+
+// Читатели без блокировок (get и get_ref) читают горячие ключи, пока писатель перезаписывает и
+// удаляет их, а поток вставок растит таблицу через серию rehash и удаляет часть своих ключей, так
+// что освобождённые узлы сразу идут под новые. Значение всегда целое; handle держит своё значение
+// неизменным, сколько бы раз ключ ни перезаписали.
+void test_lock_free_reads_under_writes() {
+    constexpr int kHotKeys = 64;
+    Table table(64);
+    std::vector<std::string> hot;
+    for (int i = 0; i < kHotKeys; ++i) {
+        hot.push_back("hot" + std::to_string(i));
+        table.put(hot.back(), make_value(hot.back(), 0));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> failed{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937 rng(static_cast<unsigned>(r));
+            std::string scratch;
+            std::uint64_t local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const std::string& key = hot[rng() % kHotKeys];
+                if (auto value = table.get(key); value && !valid_value(key, *value)) {
+                    failed.store(true);
+                }
+                if (auto handle = table.get_ref(key)) {
+                    std::string first(handle.plain(scratch));
+                    std::this_thread::yield();
+                    if (!valid_value(key, first) || handle.plain(scratch) != first) {
+                        failed.store(true);
+                    }
+                }
+                ++local;
+            }
+            reads.fetch_add(local);
+        });
+    }
+    std::thread grower([&] {
+        for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+            table.put("fill" + std::to_string(i), make_value("fill", static_cast<std::uint64_t>(i)));
+            if (i % 2 == 1) {
+                table.erase("fill" + std::to_string(i - 1));
+            }
+        }
+    });
+
+    std::mt19937 rng(42);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+    for (std::uint64_t gen = 1; std::chrono::steady_clock::now() < deadline; ++gen) {
+        const std::string& key = hot[rng() % kHotKeys];
+        if (gen % 4 == 0) {
+            table.erase(key);
+        } else {
+            table.put(key, make_value(key, gen));
+        }
+    }
+    stop.store(true);
+    grower.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    KV_CHECK(!failed.load());
+    KV_CHECK(reads.load() > 0);
+}
+
+}  // namespace
+
+int main() {
+    test_scan_while_rehashing();
+    test_lock_free_reads_under_writes();
+    std::printf("hash_table_test: OK\n");
+    return 0;
+}
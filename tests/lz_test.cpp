@@ -0,0 +1,97 @@
+// Кодек LZ: pack/unpack возвращают значение байт в байт, несжимаемое значение не пакуется,
+// повреждённый поток отвергается без выхода за границы буфера.
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "check.hpp"
+#include "kv/lz.hpp"
+
+namespace {
+
+std::string round_trip(const std::string& value) {
+    std::string packed;
+    KV_CHECK(kv::lz::pack(value, packed));
+    KV_CHECK(packed.size() < value.size());
+    KV_CHECK_EQ(kv::lz::unpacked_size(packed), value.size());
+    std::string out;
+    KV_CHECK(kv::lz::unpack(packed, out));
+    return out;
+}
+
+void test_round_trip() {
+    std::string repeated(100000, 'a');
+    KV_CHECK(round_trip(repeated) == repeated);
+
+    // Текст с повторами на разных расстояниях, в том числе длиннее окна в 64 КБ.
+    std::string text;
+    for (int i = 0; text.size() < 300000; ++i) {
+        text += "key:" + std::to_string(i % 977) + " value " + std::to_string(i * 31 % 101) + ";";
+    }
+    KV_CHECK(round_trip(text) == text);
+
+    // Совпадения, перекрывающие сами себя (смещение меньше длины).
+    std::string overlap = "ab";
+    for (int i = 0; i < 12; ++i) {
+        overlap += overlap;
+    }
+    overlap += "tail";
+    KV_CHECK(round_trip(overlap) == overlap);
+}
+
+void test_incompressible() {
+    std::mt19937_64 rng(42);
+    std::string noise(4096, '\0');
+    for (char& c : noise) {
+        c = static_cast<char>(rng());
+    }
+    std::string packed;
+    KV_CHECK(!kv::lz::pack(noise, packed));
+}
+
+void test_malformed() {
+    std::string value;
+    for (int i = 0; value.size() < 20000; ++i) {
+        value += "record " + std::to_string(i % 50) + "\n";
+    }
+    std::string packed;
+    KV_CHECK(kv::lz::pack(value, packed));
+    std::string out;
+
+    // Обрезанный поток и заголовок.
+    KV_CHECK(!kv::lz::unpack(std::string_view(packed).substr(0, packed.size() - 1), out));
+    KV_CHECK(!kv::lz::unpack(std::string_view(packed).substr(0, kv::lz::kPackedHeader - 1), out));
+
+    // Заявленная длина не совпадает с потоком.
+    std::string longer = packed;
+    longer[0] = static_cast<char>(longer[0] + 1);
+    KV_CHECK(!kv::lz::unpack(longer, out));
+
+    // Смещение совпадения за началом вывода: литерал "x", затем совпадение со смещением 2.
+    const char bad[] = {0x10, 'x', 0x02, 0x00, 0x00};
+    char dst[16];
+    KV_CHECK(!kv::lz::decompress(bad, sizeof(bad), dst, 5));
+
+    // Случайный мусор не распаковывается за пределы буфера (при ASan это видно сразу).
+    std::mt19937_64 rng(7);
+    std::string noise = packed;
+    for (int round = 0; round < 2000; ++round) {
+        noise = packed;
+        for (int i = 0; i < 4; ++i) {
+            noise[kv::lz::kPackedHeader + rng() % (noise.size() - kv::lz::kPackedHeader)] = static_cast<char>(rng());
+        }
+        if (kv::lz::unpack(noise, out)) {
+            KV_CHECK_EQ(out.size(), value.size());
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_round_trip();
+    test_incompressible();
+    test_malformed();
+    std::printf("lz_test: OK\n");
+    return 0;
+}
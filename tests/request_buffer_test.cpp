@@ -0,0 +1,83 @@
+// RequestBuffer: строки собираются из чтений любой нарезки, "\r\n" снимается, хвост без '\n'
+// ждёт следующего чтения, а строка длиннее MAX_REQUEST_SIZE распознаётся как переполнение.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/request_buffer.hpp"
+
+namespace {
+
+// Подаёт input в буфер кусками по chunk байт (как последовательные чтения из сокета) и
+// собирает выданные строки.
+std::vector<std::string> feed(kv::RequestBuffer& buffer, std::string_view input, size_t chunk) {
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (true) {
+        while (auto line = buffer.next_line()) {
+            lines.emplace_back(*line);
+        }
+        if (pos == input.size()) {
+            return lines;
+        }
+        std::span<char> space = buffer.prepare();
+        KV_CHECK(!space.empty());
+        size_t n = std::min({chunk, space.size(), input.size() - pos});
+        std::memcpy(space.data(), input.data() + pos, n);
+        buffer.commit(n);
+        pos += n;
+    }
+}
+
+void test_framing() {
+    std::string input;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 500; ++i) {
+        std::string line = "SET key" + std::to_string(i) + " " + std::string(static_cast<size_t>(i * 37 % 9000), 'v');
+        expected.push_back(line);
+        input += line + (i % 3 == 0 ? "\r\n" : "\n");
+    }
+    expected.emplace_back("");  // пустая строка тоже команда
+    input += "\n";
+    input += "GET tail";        // без '\n' — не выдаётся
+
+    for (size_t chunk : {1u, 7u, 100u, 4096u, 65536u}) {
+        kv::RequestBuffer buffer;
+        KV_CHECK(feed(buffer, input, chunk) == expected);
+        KV_CHECK(!buffer.overflow());
+
+        // Хвост дописывается следующим чтением.
+        std::span<char> space = buffer.prepare();
+        space[0] = '\n';
+        buffer.commit(1);
+        auto line = buffer.next_line();
+        KV_CHECK(line && *line == "GET tail");
+        KV_CHECK(!buffer.next_line());
+    }
+}
+
+void test_overflow() {
+    kv::RequestBuffer buffer;
+    size_t total = 0;
+    while (!buffer.overflow()) {
+        KV_CHECK(!buffer.next_line());
+        std::span<char> space = buffer.prepare();
+        KV_CHECK(!space.empty());
+        std::memset(space.data(), 'x', space.size());
+        buffer.commit(space.size());
+        total += space.size();
+    }
+    KV_CHECK(total > kv::config::MAX_REQUEST_SIZE);
+}
+
+}  // namespace
+
+int main() {
+    test_framing();
+    test_overflow();
+    std::printf("request_buffer_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,78 @@
+// ResponseBuffer: порядок байт копий и ссылок, склейка соседних копий в один фрагмент,
+// частичная запись на границах фрагментов и сброс после полной отправки.
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "check.hpp"
+#include "kv/response_buffer.hpp"
+
+namespace {
+
+std::string joined(kv::ResponseBuffer& buffer) {
+    std::string out;
+    for (const kv::IoSlice& slice : buffer.slices()) {
+        out.append(slice.data, slice.size);
+    }
+    return out;
+}
+
+void test_coalescing() {
+    kv::ResponseBuffer buffer;
+    KV_CHECK(buffer.empty());
+    buffer.append("STORED\n");
+    buffer.append("");
+    buffer.append("OK\n");
+    KV_CHECK_EQ(buffer.slices().size(), 1u);
+
+    std::string large(50000, 'v');
+    buffer.append_ref(large);
+    buffer.append("\n");
+    KV_CHECK_EQ(buffer.slices().size(), 3u);
+    KV_CHECK(buffer.slices()[1].data == large.data());
+    KV_CHECK_EQ(buffer.size(), 10 + large.size() + 1);
+    KV_CHECK(joined(buffer) == "STORED\nOK\n" + large + "\n");
+}
+
+// Частичные записи любой длины снимают ровно записанное, в том числе посреди фрагмента,
+// а копии, дописанные после частичной записи, не теряются при росте внутреннего буфера.
+void test_partial_writes() {
+    for (size_t step : {1u, 3u, 10u, 4097u}) {
+        kv::ResponseBuffer buffer;
+        std::string expected;
+        std::string sent;
+        std::string ref(20000, 'r');
+        for (int i = 0; i < 200; ++i) {
+            std::string reply = "VALUE " + std::to_string(i) + "\n";
+            buffer.append(reply);
+            expected += reply;
+            if (i % 50 == 0) {
+                buffer.append_ref(ref);
+                expected += ref;
+            }
+            // Отправляем часть после каждой команды, как при заполненном сокете.
+            std::string pending = joined(buffer);
+            size_t n = std::min(step, pending.size());
+            sent += pending.substr(0, n);
+            buffer.consume(n);
+        }
+        while (!buffer.empty()) {
+            std::string pending = joined(buffer);
+            KV_CHECK_EQ(pending.size(), buffer.size());
+            size_t n = std::min(step, pending.size());
+            sent += pending.substr(0, n);
+            buffer.consume(n);
+        }
+        KV_CHECK(sent == expected);
+        KV_CHECK(buffer.slices().empty());
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_coalescing();
+    test_partial_writes();
+    std::printf("response_buffer_test: OK\n");
+    return 0;
+}
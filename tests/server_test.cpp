@@ -0,0 +1,310 @@
+// Сквозной тест сервера: Server в фоновом потоке на свободном порту, клиенты на блокирующих
+// сокетах шлют команды конвейером и сверяют ответы.
+// Запуск: ./kv_test_server epoll|io_uring [ядра]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/logger.hpp"
+#include "kv/server.hpp"
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+
+// Свободный порт на loopback: ядро выбирает его для bind(0), сокет сразу закрывается.
+uint16_t free_port() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    KV_CHECK(fd >= 0);
+    KV_CHECK(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    KV_CHECK(::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+class Client {
+   public:
+    // Подключается к серверу, пока тот поднимает слушающий сокет (до ~5 с).
+    explicit Client(uint16_t port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            KV_CHECK(fd_ >= 0);
+            if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                return;
+            }
+            ::close(fd_);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        KV_CHECK(!"сервер не принял соединение");
+    }
+
+    ~Client() { ::close(fd_); }
+
+    // Отправляет запросы кусками по chunk байт и читает lines строк ответа (вместе с '\n').
+    std::string request(std::string_view requests, size_t lines, size_t chunk = SIZE_MAX) {
+        send_all(requests, chunk);
+        std::string reply;
+        size_t seen = 0;
+        while (seen < lines) {
+            receive(reply);
+            seen = static_cast<size_t>(std::count(reply.begin(), reply.end(), '\n'));
+        }
+        KV_CHECK_EQ(seen, lines);
+        return reply;
+    }
+
+    // Ответ заранее неизвестной длины (INFO): читает, пока он не закончится строкой end.
+    std::string request_until(std::string_view requests, std::string_view end) {
+        send_all(requests, SIZE_MAX);
+        std::string reply;
+        while (!reply.ends_with(end)) {
+            receive(reply);
+        }
+        return reply;
+    }
+
+   private:
+    int fd_ = -1;
+
+    void send_all(std::string_view bytes, size_t chunk) {
+        size_t sent = 0;
+        while (sent < bytes.size()) {
+            size_t size = std::min(chunk, bytes.size() - sent);
+            ssize_t n = ::send(fd_, bytes.data() + sent, size, MSG_NOSIGNAL);
+            KV_CHECK(n > 0);
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    void receive(std::string& reply) {
+        char buffer[4096];
+        ssize_t n = ::recv(fd_, buffer, sizeof(buffer), 0);
+        KV_CHECK(n > 0);
+        reply.append(buffer, static_cast<size_t>(n));
+    }
+};
+
+// SET ... EX <n> задаёт срок жизни; значение с таким хвостом сохраняется через " EX 0" или SETEX.
+void test_set_with_ttl(Client& client) {
+    KV_CHECK_EQ(client.request("SET timed value EX 5\nGET timed\nTTL timed\n", 3), "STORED\nvalue\n5\n");
+    KV_CHECK_EQ(client.request("SET timed value\nTTL timed\n", 2), "STORED\n-1\n");
+    KV_CHECK_EQ(client.request("SET literal value EX 5 EX 0\nGET literal\nTTL literal\n", 3),
+                "STORED\nvalue EX 5\n-1\n");
+    KV_CHECK_EQ(client.request("SETEX literal 5 value EX 5\nGET literal\nTTL literal\n", 3),
+                "STORED\nvalue EX 5\n5\n");
+    // Не строгий хвост — часть значения.
+    KV_CHECK_EQ(client.request("SET loose a EX 5s\nGET loose\nSET loose a EX \nGET loose\nTTL loose\n", 5),
+                "STORED\na EX 5s\nSTORED\na EX \n-1\n");
+    KV_CHECK_EQ(client.request("SETEX timed 0 value\nSETEX timed\nSETEX timed x value\n", 3),
+                "ERROR\nERROR\nERROR\n");
+}
+
+// CAS отклоняет пустые аргументы (двойной пробел) и слишком длинный ключ.
+void test_cas_arguments(Client& client) {
+    std::string longKey(kv::config::MAX_KEY_SIZE + 1, 'k');
+    KV_CHECK_EQ(client.request("SET c old\nCAS c old new\nCAS c old newer\nCAS  c old x\nCAS c  old x\n", 5),
+                "STORED\nSTORED\nEXISTS\nERROR\nERROR\n");
+    KV_CHECK_EQ(client.request("CAS " + longKey + " old new\nGET c\n", 2), "ERROR_TOO_LARGE\nnew\n");
+}
+
+// INCR/DECR/INCRBY: счётчик, созданный INCR, хранится числом и дальше меняется без разбора
+// текста; текстовое целое разбирается; переполнение и не целое значение — ERROR_NOT_INTEGER,
+// значение при этом не меняется. Срок жизни ключа счётчик сохраняет.
+void test_counters(Client& client) {
+    KV_CHECK_EQ(client.request("INCR n\nINCR n\nINCRBY n 40\nDECR n\nGET n\n", 5), "1\n2\n42\n41\n41\n");
+    KV_CHECK_EQ(client.request("SET t 99\nINCR t\nINCRBY t -200\nGET t\n", 4), "STORED\n100\n-100\n-100\n");
+
+    KV_CHECK_EQ(client.request("INCRBY max 9223372036854775806\nINCR max\nINCR max\nGET max\n", 4),
+                "9223372036854775806\n9223372036854775807\nERROR_NOT_INTEGER\n9223372036854775807\n");
+    KV_CHECK_EQ(client.request("INCRBY min -9223372036854775807\nDECR min\nDECR min\nINCRBY min -1\nGET min\n", 5),
+                "-9223372036854775807\n-9223372036854775808\nERROR_NOT_INTEGER\nERROR_NOT_INTEGER\n"
+                "-9223372036854775808\n");
+    KV_CHECK_EQ(client.request("SET big 9223372036854775808\nINCR big\nGET big\n", 3),
+                "STORED\nERROR_NOT_INTEGER\n9223372036854775808\n");
+
+    KV_CHECK_EQ(client.request("SET s abc\nINCR s\nSET s 12a\nINCR s\nSET s 1.5\nDECR s\nGET s\n", 7),
+                "STORED\nERROR_NOT_INTEGER\nSTORED\nERROR_NOT_INTEGER\nSTORED\nERROR_NOT_INTEGER\n1.5\n");
+    KV_CHECK_EQ(client.request("INCRBY n\nINCRBY n x\nINCRBY n 99999999999999999999\nGET n\n", 4),
+                "ERROR\nERROR\nERROR\n41\n");
+
+    KV_CHECK_EQ(client.request("SETEX timedcount 100 5\nINCR timedcount\nTTL timedcount\n", 3), "STORED\n6\n100\n");
+}
+
+// APPEND создаёт отсутствующий ключ и дописывает к числу, записанному INCR, его десятичную запись.
+void test_append(Client& client) {
+    KV_CHECK_EQ(client.request("APPEND fresh abc\nAPPEND fresh def\nGET fresh\n", 3), "3\n6\nabcdef\n");
+    KV_CHECK_EQ(client.request("INCRBY num -12\nAPPEND num 34\nGET num\nINCR num\n", 4), "-12\n5\n-1234\n-1233\n");
+    KV_CHECK_EQ(client.request("INCR word\nAPPEND word x\nINCR word\nGET word\n", 4),
+                "1\n2\nERROR_NOT_INTEGER\n1x\n");
+    KV_CHECK_EQ(client.request("APPEND fresh\n", 1), "ERROR\n");
+}
+
+// Конвейер из сотен команд разных видов одной отправкой (и кусками, режущими команды посередине):
+// ответы приходят по порядку, крупные значения — целиком.
+void test_pipeline(uint16_t port, const std::string& prefix) {
+    Client client(port);
+    std::string requests;
+    std::string expected;
+    size_t lines = 0;
+    auto add = [&](const std::string& request, const std::string& reply) {
+        requests += request + "\n";
+        expected += reply;
+        lines += static_cast<size_t>(std::count(reply.begin(), reply.end(), '\n'));
+    };
+    for (int i = 0; i < 200; ++i) {
+        std::string n = prefix + std::to_string(i);
+        std::string value = i % 20 == 0 ? std::string(5000 + static_cast<size_t>(i), 'L') : "v" + n;
+        add("SET k" + n + " " + value, "STORED\n");
+        add("GET k" + n, value + "\n");
+        add("MSET a" + n + " x" + n + " b" + n + " y" + n, "STORED\n");
+        add("MGET a" + n + " missing" + n + " b" + n, "x" + n + "\nNOT_FOUND\ny" + n + "\nEND\n");
+        add("CAS k" + n + " " + value + " w" + n, "STORED\n");
+        add("CAS k" + n + " " + value + " z" + n, "EXISTS\n");
+        add("GET k" + n, "w" + n + "\n");
+        add("EXPIRE k" + n + " 1000", "OK\n");
+        add("EXPIRE missing" + n + " 1000", "NOT_FOUND\n");
+        add("DEL a" + n, "DELETED\n");
+        add("GET a" + n, "NOT_FOUND\n");
+    }
+    for (size_t chunk : {SIZE_MAX, size_t{997}}) {
+        KV_CHECK(client.request(requests, lines, chunk) == expected);
+    }
+    std::string ttl = client.request("TTL k" + prefix + "0\n", 1);
+    KV_CHECK(ttl == "1000\n" || ttl == "999\n");
+}
+
+// Несколько клиентов одновременно, каждый со своими ключами.
+void test_concurrent_clients(uint16_t port) {
+    std::vector<std::thread> clients;
+    for (int c = 0; c < 4; ++c) {
+        clients.emplace_back([port, c] { test_pipeline(port, "c" + std::to_string(c) + ":"); });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+}
+
+// EXPIRE действительно убирает ключ: через секунду с небольшим его уже нет.
+void test_expiry(Client& client) {
+    KV_CHECK_EQ(client.request("SET short v\nEXPIRE short 1\nGET short\n", 3), "STORED\nOK\nv\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    KV_CHECK_EQ(client.request("GET short\nTTL short\n", 2), "NOT_FOUND\n-2\n");
+}
+
+// Значение счётчика "name:" из ответа INFO (0, если строки нет).
+std::uint64_t info_counter(std::string_view info, std::string_view name) {
+    std::string prefix = "\n" + std::string(name) + ":";
+    size_t pos = info.find(prefix);
+    if (pos == std::string_view::npos) {
+        return 0;
+    }
+    return std::strtoull(info.data() + pos + prefix.size(), nullptr, 10);
+}
+
+// После массового удаления дефрагментация переносит живые узлы из разреженных арен (в режиме
+// ядер — каждое ядро свои шарды); значения оставшихся ключей при этом не меняются.
+void test_defrag_keeps_values(Client& client) {
+    constexpr int kKeys = 40000;
+    const std::string value(100, 'd');
+    for (int batch = 0; batch < kKeys; batch += 1000) {
+        std::string requests;
+        for (int i = batch; i < batch + 1000; ++i) {
+            requests += "SET frag" + std::to_string(i) + " " + value + "\n";
+        }
+        client.request(requests, 1000);
+    }
+    std::string deletes;
+    for (int i = 0; i < kKeys; ++i) {
+        if (i % 10 != 0) {
+            deletes += "DEL frag" + std::to_string(i) + "\n";
+        }
+    }
+    client.request(deletes, kKeys - kKeys / 10);
+
+    // Проход должен и перенести узлы, и опустошить осушаемые арены.
+    std::string info;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        info = client.request_until("INFO memory\n", "END\n");
+    } while ((info_counter(info, "defrag_moved_nodes") == 0 || info_counter(info, "defrag_reclaimed_bytes") == 0) &&
+             std::chrono::steady_clock::now() < deadline);
+    KV_CHECK(info_counter(info, "defrag_moved_nodes") > 0);
+    KV_CHECK(info_counter(info, "defrag_reclaimed_bytes") > 0);
+
+    std::string gets;
+    std::string expected;
+    for (int i = 0; i < kKeys; i += 10) {
+        gets += "GET frag" + std::to_string(i) + "\n";
+        expected += value + "\n";
+    }
+    KV_CHECK(client.request(gets, kKeys / 10) == expected);
+}
+
+// Цикл событий работает на запрошенном механизме (io_uring без поддержки ядра заменяется epoll).
+void check_backend(Client& client, std::string_view backend) {
+    std::string info = client.request_until("INFO\n", "END\n");
+    if (info.find("io_backend:" + std::string(backend) + "\n") == std::string::npos) {
+        KV_CHECK(backend == "io_uring" && info.find("io_backend:epoll\n") != std::string::npos);
+        std::printf("io_uring недоступен, проверяется epoll\n");
+    }
+}
+
+#endif
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifndef _WIN32
+    kv::log::LoggerConfig cfg;
+    cfg.level = kv::log::Level::WARN;
+    kv::log::Logger::instance().init(cfg);
+
+    std::string_view backend = argc >= 2 ? argv[1] : "epoll";
+    kv::EventLoop::prefer_backend(backend == "io_uring" ? kv::IoBackend::IoUring : kv::IoBackend::Epoll);
+
+    uint16_t port = free_port();
+    // Сервер работает до конца процесса: run() не возвращается, поэтому поток отсоединён,
+    // а main завершается через _Exit.
+    auto* server = new kv::Server<std::string, std::string>("127.0.0.1", port);
+    if (argc >= 3) {
+        server->set_core_threads(std::stoul(argv[2]));
+    }
+    std::thread([server] { server->run(); }).detach();
+
+    Client client(port);
+    check_backend(client, backend);
+    test_set_with_ttl(client);
+    test_cas_arguments(client);
+    test_counters(client);
+    test_append(client);
+    test_pipeline(port, "p:");
+    test_concurrent_clients(port);
+    test_expiry(client);
+    test_defrag_keeps_values(client);
+
+    std::printf("server_test (%.*s): OK\n", static_cast<int>(backend.size()), backend.data());
+    std::fflush(stdout);
+#endif
+    std::_Exit(0);
+}
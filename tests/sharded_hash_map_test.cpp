@@ -0,0 +1,175 @@
+// ShardedHashMap: разделение шардов (RESHARD) под одновременными GET/SET/DEL/SCAN, случаи,
+// когда рост числа шардов запрещён, и SCAN, пока шарды растут (rehash).
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "check.hpp"
+#include "kv/sharded_hash_map.hpp"
+
+namespace {
+
+using Map = kv::ShardedHashMap<std::string, std::string>;
+
+constexpr int kStableKeys = 20000;
+constexpr int kWriters = 2;
+constexpr int kWriterKeys = 20000;
+
+std::string stable_key(int i) { return "stable:" + std::to_string(i); }
+
+std::string writer_key(int writer, int i) { return "w" + std::to_string(writer) + ":" + std::to_string(i); }
+
+// Полный SCAN: сколько раз выдан каждый ключ.
+std::unordered_map<std::string, int> scan_all(Map& map) {
+    std::unordered_map<std::string, int> seen;
+    std::uint64_t cursor = 0;
+    do {
+        cursor = map.scan(cursor, 100, [&](const auto& key) { ++seen[std::string(key)]; });
+    } while (cursor != 0);
+    return seen;
+}
+
+// Шарды делятся с 4 до 32, пока писатели добавляют и удаляют свои ключи, читатели читают
+// неизменные ключи, а SCAN обходит карту. Неизменные ключи всё время читаются и каждый полный
+// SCAN их выдаёт; после разделения каждый ключ лежит ровно в одном шарде.
+void test_reshard_under_load() {
+    Map map(4);
+    for (int i = 0; i < kStableKeys; ++i) {
+        map.put(stable_key(i), "v" + std::to_string(i));
+    }
+    KV_CHECK(map.grow_shards(32));
+    KV_CHECK(map.resharding());
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < kWriters; ++w) {
+        threads.emplace_back([&, w] {
+            for (int i = 0; i < kWriterKeys; ++i) {
+                map.put(writer_key(w, i), std::to_string(i));
+                if (i % 3 == 0) {
+                    map.put(writer_key(w, i), "updated");
+                }
+                if (i % 5 == 0 && !map.erase(writer_key(w, i))) {
+                    failed.store(true);
+                }
+            }
+        });
+    }
+    for (int r = 0; r < 2; ++r) {
+        threads.emplace_back([&, r] {
+            for (int i = r; !stop.load(std::memory_order_relaxed); i = (i + 7919) % kStableKeys) {
+                auto value = map.get(stable_key(i));
+                if (!value || *value != "v" + std::to_string(i)) {
+                    failed.store(true);
+                }
+            }
+        });
+    }
+    std::atomic<int> scans{0};
+    threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto seen = scan_all(map);
+            for (int i = 0; i < kStableKeys; ++i) {
+                if (!seen.contains(stable_key(i))) {
+                    failed.store(true);
+                }
+            }
+            scans.fetch_add(1);
+        }
+    });
+
+    while (map.resharding()) {
+        map.reshard_cycle();
+    }
+    for (int w = 0; w < kWriters; ++w) {
+        threads[w].join();
+    }
+    while (scans.load() < 1) {
+        std::this_thread::yield();
+    }
+    stop.store(true);
+    for (size_t t = kWriters; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    KV_CHECK(!failed.load());
+    KV_CHECK_EQ(map.shard_count(), 32u);
+
+    size_t expected = kStableKeys;
+    for (int w = 0; w < kWriters; ++w) {
+        for (int i = 0; i < kWriterKeys; ++i) {
+            auto value = map.get(writer_key(w, i));
+            if (i % 5 == 0) {
+                KV_CHECK(!value);
+                continue;
+            }
+            KV_CHECK(value.has_value());
+            KV_CHECK_EQ(*value, i % 3 == 0 ? std::string("updated") : std::to_string(i));
+            ++expected;
+        }
+    }
+    KV_CHECK_EQ(map.size(), expected);
+    auto seen = scan_all(map);
+    KV_CHECK_EQ(seen.size(), expected);
+    for (const auto& [key, times] : seen) {
+        KV_CHECK_EQ(times, 1);
+    }
+}
+
+// Полные SCAN, пока другой поток вставляет ключи и шарды проходят через rehash: каждый
+// обход выдаёт все ключи, лежавшие в карте до его начала, и заканчивается курсором 0.
+void test_scan_while_shards_rehash() {
+    Map map(4);
+    for (int i = 0; i < kStableKeys; ++i) {
+        map.put(stable_key(i), "v");
+    }
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 0; i < 10 * kStableKeys; ++i) {
+            map.put("grow:" + std::to_string(i), "v");
+        }
+        done.store(true);
+    });
+    int scans = 0;
+    do {
+        auto seen = scan_all(map);
+        for (int i = 0; i < kStableKeys; ++i) {
+            KV_CHECK(seen.contains(stable_key(i)));
+        }
+        ++scans;
+    } while (!done.load());
+    writer.join();
+    KV_CHECK(scans > 0);
+    KV_CHECK_EQ(map.size(), static_cast<size_t>(11 * kStableKeys));
+}
+
+// Число шардов нельзя уменьшить, поднять выше предела массива шардов и менять в режиме
+// ядро-на-поток, где владелец шарда задан его номером.
+void test_reshard_refused() {
+    Map map(8);
+    KV_CHECK(!map.grow_shards(4));
+    KV_CHECK(!map.grow_shards(kv::config::MAX_HASH_MAP_SHARDS + 1));
+    KV_CHECK(!map.resharding());
+    KV_CHECK(map.grow_shards(kv::config::MAX_HASH_MAP_SHARDS));
+    KV_CHECK(map.resharding());
+
+    Map cores(8);
+    cores.set_single_writer(true);
+    KV_CHECK(!cores.grow_shards(16));
+    KV_CHECK(!cores.resharding());
+    cores.reshard_cycle();
+    KV_CHECK_EQ(cores.shard_count(), 8u);
+}
+
+}  // namespace
+
+int main() {
+    test_reshard_under_load();
+    test_reshard_refused();
+    test_scan_while_shards_rehash();
+    std::printf("sharded_hash_map_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+// SpscQueue: ёмкость, полная и пустая очередь, переход индексов через границу кольца и обмен
+// между двумя потоками.
+#include <cstdio>
+#include <thread>
+
+#include "check.hpp"
+#include "kv/spsc_queue.hpp"
+
+namespace {
+
+void test_full_and_empty() {
+    kv::SpscQueue<int> queue(5);  // округляется до 8
+    int item = -1;
+    KV_CHECK(!queue.pop(item));
+    for (int i = 0; i < 8; ++i) {
+        KV_CHECK(queue.push(i));
+    }
+    KV_CHECK(!queue.push(8));
+    for (int i = 0; i < 8; ++i) {
+        KV_CHECK(queue.pop(item));
+        KV_CHECK_EQ(item, i);
+    }
+    KV_CHECK(!queue.pop(item));
+}
+
+// Индексы растут без ограничения и маскируются: порядок сохраняется на любом витке кольца.
+void test_wraparound() {
+    kv::SpscQueue<int> queue(4);
+    int next = 0;
+    int expected = 0;
+    int item = -1;
+    for (int round = 0; round < 1000; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            KV_CHECK(queue.push(next++));
+        }
+        for (int i = 0; i < 2; ++i) {
+            KV_CHECK(queue.pop(item));
+            KV_CHECK_EQ(item, expected++);
+        }
+        while (queue.pop(item)) {
+            KV_CHECK_EQ(item, expected++);
+        }
+    }
+    KV_CHECK_EQ(expected, next);
+}
+
+void test_two_threads() {
+    constexpr int kItems = 1'000'000;
+    kv::SpscQueue<int> queue(64);
+    std::thread producer([&queue] {
+        for (int i = 0; i < kItems; ++i) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int item = -1;
+    for (int expected = 0; expected < kItems; ++expected) {
+        while (!queue.pop(item)) {
+            std::this_thread::yield();
+        }
+        KV_CHECK_EQ(item, expected);
+    }
+    producer.join();
+    KV_CHECK(!queue.pop(item));
+}
+
+}  // namespace
+
+int main() {
+    test_full_and_empty();
+    test_wraparound();
+    test_two_threads();
+    std::printf("spsc_queue_test: OK\n");
+    return 0;
+}